@@ -0,0 +1,169 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+// Tiny benchmark harness shared by *-bench.cpp drivers (one driver per header).
+// build: g++ -O2 -march=native -std=c++20 -o fenwick-tree-bench fenwick-tree-bench.cpp
+// run:   ./fenwick-tree-bench [max_size [min_size]]   (default 1e3 .. 1e8, step x10)
+// Output: one line per (operation, size):
+//   name  size  ns/op  bytes/elem  cache-misses/op
+// cache-misses/op is printed as `-` when perf_event_open(2) is unavailable
+// (non-linux, or kernel.perf_event_paranoid forbids it).
+// bytes/elem is heap growth during build divided by size (global operator new is
+// replaced below, so every driver must be a single translation unit).
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+namespace Bench {
+    inline std::atomic<std::size_t> live_bytes_counter = 0;
+    inline std::size_t live_bytes() { return live_bytes_counter.load(std::memory_order_relaxed); }
+
+    class CacheMisses {
+        int fd = -1;
+        public:
+        CacheMisses() {
+#ifdef __linux__
+            perf_event_attr pe {};
+            pe.type = PERF_TYPE_HARDWARE;
+            pe.size = sizeof(pe);
+            pe.config = PERF_COUNT_HW_CACHE_MISSES;
+            pe.disabled = 1;
+            pe.exclude_kernel = 1;
+            pe.exclude_hv = 1;
+            fd = syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+#endif
+        }
+        CacheMisses(const CacheMisses &) = delete;
+        ~CacheMisses() {
+#ifdef __linux__
+            if (fd >= 0)
+                close(fd);
+#endif
+        }
+        bool valid() const { return fd >= 0; }
+        void start() {
+#ifdef __linux__
+            if (fd < 0) return;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+        std::uint64_t stop() {
+            std::uint64_t count = 0;
+#ifdef __linux__
+            if (fd < 0) return 0;
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count))
+                count = 0;
+#endif
+            return count;
+        }
+    };
+
+    // keep `v` alive without letting the optimizer see through it
+    template <typename T>
+    inline void keep(const T &v) { asm volatile("" : : "r,m"(v) : "memory"); }
+
+    inline std::vector<std::size_t> sizes(int argc, char *argv[]) {
+        std::size_t hi = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 100'000'000;
+        std::size_t lo = argc > 2 ? std::strtoull(argv[2], nullptr, 0) : 1'000;
+        std::vector<std::size_t> res;
+        for (std::size_t n = lo; n && n <= hi; n *= 10)
+            res.push_back(n);
+        return res;
+    }
+
+    // number of operations timed per (operation, size)
+    inline std::size_t ops(std::size_t n) { return n < 1'000'000 ? 1'000'000 : n < 10'000'000 ? n : 10'000'000; }
+
+    typedef std::mt19937_64 rng_type;
+    inline rng_type rng(std::uint64_t salt = 0) { return rng_type(0x5eed + salt); }
+
+    inline void header() {
+        std::printf("%-40s %12s %10s %10s %10s\n", "name", "size", "ns/op", "B/elem", "miss/op");
+    }
+
+    // time `body()`, which performs `count` operations over a structure of `n` elements,
+    // and which allocated `bytes` bytes for it
+    template <typename Body>
+    void run(const char *name, std::size_t n, std::size_t count, std::size_t bytes, Body body) {
+        CacheMisses cm;
+        cm.start();
+        auto t0 = std::chrono::steady_clock::now();
+        body();
+        auto t1 = std::chrono::steady_clock::now();
+        auto misses = cm.stop();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        std::printf("%-40s %12zu %10.2f %10.2f ", name, n, ns/count, n ? double(bytes)/n : 0.);
+        if (cm.valid())
+            std::printf("%10.3f\n", double(misses)/count);
+        else
+            std::printf("%10s\n", "-");
+        std::fflush(stdout);
+    }
+
+    // time construction; returns the constructed object and reports heap growth per element
+    template <typename Build>
+    auto build(const char *name, std::size_t n, Build make) {
+        auto before = live_bytes();
+        CacheMisses cm;
+        cm.start();
+        auto t0 = std::chrono::steady_clock::now();
+        auto res = make();
+        auto t1 = std::chrono::steady_clock::now();
+        auto misses = cm.stop();
+        auto bytes = live_bytes() - before;
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        std::printf("%-40s %12zu %10.2f %10.2f ", name, n, ns/n, double(bytes)/n);
+        if (cm.valid())
+            std::printf("%10.3f\n", double(misses)/n);
+        else
+            std::printf("%10s\n", "-");
+        std::fflush(stdout);
+        return res;
+    }
+
+    // random [l; r) pairs with l < r <= n
+    inline auto ranges(std::size_t n, std::size_t count, std::uint64_t salt = 0) {
+        auto g = rng(salt);
+        std::vector<std::pair<std::size_t, std::size_t>> res(count);
+        for (auto &[l, r]: res) {
+            l = g() % n;
+            r = g() % n;
+            if (l > r) std::swap(l, r);
+            ++r;
+        }
+        return res;
+    }
+}
+
+// heap accounting for bytes/elem
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#pragma GCC diagnostic ignored "-Warray-bounds"
+void *operator new(std::size_t size) {
+    auto p = static_cast<std::size_t *>(std::malloc(size + sizeof(std::max_align_t)));
+    if (!p) throw std::bad_alloc();
+    *p = size;
+    Bench::live_bytes_counter.fetch_add(size, std::memory_order_relaxed);
+    return reinterpret_cast<char *>(p) + sizeof(std::max_align_t);
+}
+void operator delete(void *ptr) noexcept {
+    if (!ptr) return;
+    auto p = reinterpret_cast<std::size_t *>(static_cast<char *>(ptr) - sizeof(std::max_align_t));
+    Bench::live_bytes_counter.fetch_sub(*p, std::memory_order_relaxed);
+    std::free(p);
+}
+void operator delete(void *ptr, std::size_t) noexcept { operator delete(ptr); }
+#pragma GCC diagnostic pop
+#endif // BENCH_HPP
+// vim: sw=4 et
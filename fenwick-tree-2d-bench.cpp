@@ -0,0 +1,78 @@
+#include <bits/stdc++.h>
+#include "bench.hpp"
+#include "fenwick-tree-2d.hpp"
+using namespace std;
+// see bench.hpp for build/run instructions; size is the number of cells of a square grid
+// (the number of points for the sparse tree)
+template <typename Tree>
+void bench_fenwick2d(const string &prefix, size_t n, Tree &ft, size_t bytes, const vector<pair<size_t, size_t>> &pos, const vector<int64_t> &val) {
+    const auto m = pos.size();
+    Bench::run((prefix + "/add").c_str(), n, m, bytes, [&]() {
+        for (size_t i = 0; i < m; ++i)
+            ft.add(pos[i].first, pos[i].second, val[i]);
+    });
+    Bench::run((prefix + "/prefix_sum").c_str(), n, m, bytes, [&]() {
+        int64_t acc = 0;
+        for (auto [x, y]: pos)
+            acc += ft.prefix_sum(x, y);
+        Bench::keep(acc);
+    });
+    Bench::run((prefix + "/range_sum").c_str(), n, m, bytes, [&]() {
+        int64_t acc = 0;
+        for (size_t i = 0; i + 1 < m; ++i) {
+            auto [x0, y0] = pos[i];
+            auto [x1, y1] = pos[i + 1];
+            acc += ft.range_sum(min(x0, x1), min(y0, y1), max(x0, x1), max(y0, y1));
+        }
+        Bench::keep(acc);
+    });
+}
+int main(int argc, char *argv[]) {
+    Bench::header();
+    for (auto n: Bench::sizes(argc, argv)) {
+        const size_t side = sqrt(double(n));
+        const auto cells = side*side;
+        const auto m = Bench::ops(cells);
+        auto g = Bench::rng();
+        vector<pair<size_t, size_t>> pos(m);
+        vector<int64_t> val(m);
+        for (size_t i = 0; i < m; ++i) {
+            pos[i] = { g() % side, g() % side };
+            val[i] = g() % 1000;
+        }
+        {
+            auto bytes = Bench::live_bytes();
+            auto ft = Bench::build("fenwick2d/build", cells, [&]() { return FenwickTree2D<int64_t>(side, side); });
+            bytes = Bench::live_bytes() - bytes;
+            bench_fenwick2d("fenwick2d", cells, ft, bytes, pos, val);
+        }
+        {
+            auto bytes = Bench::live_bytes();
+            auto ft = Bench::build("fenwick2d-flat/build", cells, [&]() { return FenwickTree2DFlat<int64_t>(side, side); });
+            bytes = Bench::live_bytes() - bytes;
+            bench_fenwick2d("fenwick2d-flat", cells, ft, bytes, pos, val);
+        }
+        if (n <= 1'000'000) {
+            // n points in a 1e9 x 1e9 plane; updates and query corners are stored points
+            vector<pair<int, int>> pts(n);
+            for (auto &[x, y]: pts) {
+                x = g() % 1'000'000'000;
+                y = g() % 1'000'000'000;
+            }
+            const auto mp = Bench::ops(n);
+            vector<pair<size_t, size_t>> ppos(mp);
+            vector<int64_t> pval(mp);
+            for (size_t i = 0; i < mp; ++i) {
+                auto [x, y] = pts[g() % n];
+                ppos[i] = { x, y };
+                pval[i] = g() % 1000;
+            }
+            auto bytes = Bench::live_bytes();
+            auto ft = Bench::build("fenwick2d-sparse/build", n, [&]() { return FenwickTree2DSparse<int64_t, int>(pts); });
+            bytes = Bench::live_bytes() - bytes;
+            bench_fenwick2d("fenwick2d-sparse", n, ft, bytes, ppos, pval);
+        }
+    }
+    return 0;
+}
+// vim: sw=4 et
@@ -28,6 +28,7 @@ int main() {
 		n = 10000/m;
 	}
 	FenwickTree2D<int> ft(m, n);
+	FenwickTree2DFlat<int> flat(m, n);
 	vector<vector<int>> mat(m, vector<int>(n));
 	const unsigned vr = (INT_MAX/(n*m*1000));
 	vector<int> temp(m);
@@ -38,6 +39,7 @@ int main() {
 	    unsigned tv = rng() % vr;
 	    clog << m << 'x' << n << ' ' << ti << ',' << tj << '+' << tv << '\r' << flush;
 	    ft.add(ti, tj, tv);
+	    flat.add(ti, tj, tv);
 	    mat[ti][tj] += tv;
 	    temp.clear();
 	    temp.resize(n);
@@ -53,12 +55,44 @@ int main() {
 		    cout << ' ' << temp[j] << flush;
 #endif
 		    assert(temp[j] == ft.prefix_sum(i, j));
+		    assert(temp[j] == flat.prefix_sum(i, j));
 		}
 #if DEBUG
 		cout << endl;
 #endif
 	    }
 	}
+	if (m && n)
+	    assert(vector<vector<int>>(ft) == mat);
+    }
+    // sparse points in a 1e9 x 1e9 plane against brute force
+    for (unsigned t = 1; t < 100; ++t) {
+	const int R = t % 2 ? 1'000'000'000 : 16;
+	vector<pair<int, int>> pts(rng() % 500);
+	for (auto &[x, y]: pts) {
+	    x = rng() % R;
+	    y = rng() % R;
+	}
+	FenwickTree2DSparse<int64_t, int> ft(pts);
+	vector<int64_t> val(pts.size());
+	for (unsigned subt = 0; subt < 1000; ++subt) {
+	    if (!pts.empty()) {
+		unsigned k = rng() % pts.size();
+		unsigned tv = rng() % 1000;
+		ft.add(pts[k].first, pts[k].second, tv);
+		val[k] += tv;
+	    }
+	    int x0 = rng() % R, x1 = rng() % R, y0 = rng() % R, y1 = rng() % R;
+	    if (x0 > x1)
+		swap(x0, x1);
+	    if (y0 > y1)
+		swap(y0, y1);
+	    int64_t sum = 0;
+	    for (unsigned k = 0; k < pts.size(); ++k)
+		if (x0 < pts[k].first && pts[k].first <= x1 && y0 < pts[k].second && pts[k].second <= y1)
+		    sum += val[k];
+	    assert(sum == ft.range_sum(x0, y0, x1, y1));
+	}
     }
     return 0;
 }
@@ -1,6 +1,29 @@
 #ifndef FENWICK_TREE_2D_HPP
 #define FENWICK_TREE_2D_HPP
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
 #include <vector>
+// Row-major m x n grid in a single allocation; drop-in storage for FenwickTree2D
+// in place of the default vector<vector<T>> (A[i] is a span over row i)
+template <typename T, typename V = std::vector<T>>
+class FlatGrid {
+    V A;
+    std::size_t m = 0, n = 0;
+    public:
+    typedef std::size_t size_type;
+    FlatGrid(size_type m = 0, size_type n = 0) : A(m*n), m(m), n(n) {}
+
+    std::span<T> operator [](size_type i) { return { A.data() + i*n, n }; }
+    std::span<const T> operator [](size_type i) const { return { A.data() + i*n, n }; }
+
+    size_type size() const { return m; }
+
+    bool empty() const { return m == 0; }
+};
+
 template <typename T, typename V = std::vector<std::vector<T>>>
 class FenwickTree2D {
     // One-based Fenwick tree with a twist (A[0] saves nums[0])
@@ -15,50 +38,47 @@ class FenwickTree2D {
 
     // Convert A[] in place to Fenwick tree form
     static void init(V &A) {
-	for (size_type yi = 1; yi < A[0].size(); ++yi) {
-            auto yj = yi + LSB(yi);
-            if (yj < A[0].size())
-                A[0][yj] += A[0][yi];
-	}
-        for (size_type xi = 1; xi < A.size(); ++xi) {
-	    auto xj = xi + LSB(xi);
-	    if (xj < A.size()) {
-		A[xj][0] += A[xi][0];
-		for (size_type yi = 1; yi < A[0].size(); ++yi) {
-		    auto yj = yi + LSB(yi);
-		    if (yj < A[0].size())
-			A[xj][yj] += A[xi][yi];
-		}
-	    }
-        }
+        if (A.empty())
+            return;
+        const auto n = A[0].size();
+        // rows along y (column 0 stays per-element), then whole rows along x
+        for (size_type xi = 0; xi < A.size(); ++xi)
+            for (size_type yi = 1; yi < n; ++yi)
+                if (auto yj = yi + LSB(yi); yj < n)
+                    A[xi][yj] += A[xi][yi];
+        for (size_type xi = 1; xi < A.size(); ++xi)
+            if (auto xj = xi + LSB(xi); xj < A.size())
+                for (size_type y = 0; y < n; ++y)
+                    A[xj][y] += A[xi][y];
     }
 
     // Convert back to array of per-element counts
     static void fini(V &A) {
-        for (size_type yi = A[0].size(); yi-- > 1; ) {
-            auto yj = yi + LSB(yi);
-            if (yj < A[0].size())
-                A[0][yj] -= A[0][yi];
-        }
-        for (size_type xi = A.size(); xi-- > 1; ) {
-            auto xj = xi + LSB(xi);
-            if (xj < A.size()) {
-                A[xj] -= A[xi];
-		for (size_type yi = A[0].size(); yi-- > 1; ) {
-		    auto yj = yi + LSB(yi);
-		    if (yj < A[0].size())
-			A[xj][yj] -= A[xi][yi];
-		}
-	    }
-        }
+        if (A.empty())
+            return;
+        const auto n = A[0].size();
+        for (size_type xi = A.size(); xi-- > 1; )
+            if (auto xj = xi + LSB(xi); xj < A.size())
+                for (size_type y = 0; y < n; ++y)
+                    A[xj][y] -= A[xi][y];
+        for (size_type xi = 0; xi < A.size(); ++xi)
+            for (size_type yi = n; yi-- > 1; )
+                if (auto yj = yi + LSB(yi); yj < n)
+                    A[xi][yj] -= A[xi][yi];
+    }
+    static V make(size_type m, size_type n) {
+        if constexpr (std::is_constructible_v<V, size_type, size_type>)
+            return V(m, n);
+        else
+            return V(m, typename V::value_type(n));
     }
     public:
-    FenwickTree2D(size_type m, size_type n):A(m, typename V::value_type(n)) {}
+    FenwickTree2D(size_type m, size_type n):A(make(m, n)) {}
     FenwickTree2D(FenwickTree2D &&) = default;
     FenwickTree2D(const FenwickTree2D &) = default;
 
-    FenwickTree2D(const V &other) : A(other.A) { init(A); }
-    FenwickTree2D(V &&other) : A(move(other.A)) { init(A); }
+    FenwickTree2D(const V &other) : A(other) { init(A); }
+    FenwickTree2D(V &&other) : A(std::move(other)) { init(A); }
     operator V () const & {
         V ret = A;
         fini(ret);
@@ -88,9 +108,10 @@ class FenwickTree2D {
 	for (auto j = y; j != 0; j -= LSB(j))
 	    sum += A[0][j];
         for (auto i = x; i != 0; i -= LSB(i)) {
-	    sum += A[i][0];
+            auto &&row = A[i];
+	    sum += row[0];
             for (auto j = y; j != 0; j -= LSB(j))
-                sum += A[i][j];
+                sum += row[j];
 	}
         return sum;
     }
@@ -112,9 +133,11 @@ class FenwickTree2D {
                 A[0][j] += delta;
             return;
 	}
+        const auto n = A[0].size();
         for (auto i = x; i < A.size(); i += LSB(i)) {
-            for (auto j = y; j < A[0].size(); j += LSB(j))
-                A[i][j] += delta;
+            auto &&row = A[i];
+            for (auto j = y; j < n; j += LSB(j))
+                row[j] += delta;
 	}
     }
 
@@ -171,7 +194,8 @@ class FenwickTree2D {
 		sum += prefix_sum(xi - 1, yi - 1);
 	}
 	if (yi > 0)
-	    sum -= prefix_sum(xj, yi);
+	    sum -= prefix_sum(xj, yi - 1);
+	return sum;
     }
 #if 0 
     //
@@ -288,4 +312,106 @@ class FenwickTree2D {
     FenwickReference back() { return (*this)[size() - 1]; }
 #endif
 };
+
+template <typename T>
+using FenwickTree2DFlat = FenwickTree2D<T, FlatGrid<T>>;
+
+// Offline-compressed 2D Fenwick tree over a fixed set of points in a large plane.
+// Outer tree over the sorted distinct x, node i holds the sorted distinct y of
+// the points it covers and a 1D Fenwick tree over them; all nodes are packed
+// into flat arrays (node i owns Y[start[i]..start[i + 1]) and the same range of A).
+// space: O(N log N), add / prefix_sum: O(log^2 N)
+template <typename T, typename C = std::int64_t>
+class FenwickTree2DSparse {
+    public:
+    typedef std::size_t size_type;
+    typedef T value_type;
+    typedef C coord_type;
+    private:
+    std::vector<C> X;                   // sorted distinct x
+    std::vector<size_type> start;       // X.size() + 2 offsets, node i is one-based
+    std::vector<C> Y;
+    std::vector<T> A;
+
+    static size_type LSB(size_type i) {
+        return i & -i;
+    }
+    public:
+    FenwickTree2DSparse() : start(2) {}
+
+    // points that add() may be called with; duplicates are fine
+    FenwickTree2DSparse(std::span<const std::pair<C, C>> points) {
+        for (auto &p: points)
+            X.push_back(p.first);
+        std::sort(X.begin(), X.end());
+        X.erase(std::unique(X.begin(), X.end()), X.end());
+        const auto nx = X.size();
+        std::vector<size_type> rank(points.size());
+        start.assign(nx + 2, 0);
+        for (size_type k = 0; k < points.size(); ++k) {
+            rank[k] = std::lower_bound(X.begin(), X.end(), points[k].first) - X.begin() + 1;
+            for (auto i = rank[k]; i <= nx; i += LSB(i))
+                ++start[i + 1];
+        }
+        for (size_type i = 1; i <= nx; ++i)
+            start[i + 1] += start[i];
+        Y.resize(start[nx + 1]);
+        {
+            auto pos = start;
+            for (size_type k = 0; k < points.size(); ++k)
+                for (auto i = rank[k]; i <= nx; i += LSB(i))
+                    Y[pos[i]++] = points[k].second;
+        }
+        // sort and dedup every node, compacting Y and start in place
+        size_type out = 0;
+        for (size_type i = 1; i <= nx; ++i) {
+            const auto b = Y.begin() + start[i], e = Y.begin() + start[i + 1];
+            std::sort(b, e);
+            const auto u = std::unique(b, e);
+            const auto d = Y.begin() + out;
+            start[i] = out;
+            out = (d == b ? u : std::copy(b, u, d)) - Y.begin();
+        }
+        start[nx + 1] = out;
+        Y.resize(out);
+        Y.shrink_to_fit();
+        A.assign(out, T(0));
+    }
+
+    FenwickTree2DSparse(const std::vector<std::pair<C, C>> &points) : FenwickTree2DSparse(std::span<const std::pair<C, C>>(points)) {}
+
+    // Add delta to the point (x, y), which must be one of the constructor's points
+    void add(C x, C y, T delta) {
+        const auto nx = X.size();
+        for (size_type i = std::lower_bound(X.begin(), X.end(), x) - X.begin() + 1; i <= nx; i += LSB(i)) {
+            const auto b = start[i], len = start[i + 1] - b;
+            for (size_type j = std::lower_bound(Y.begin() + b, Y.begin() + b + len, y) - Y.begin() - b + 1; j <= len; j += LSB(j))
+                A[b + j - 1] += delta;
+        }
+    }
+
+    // Returns the sum of the points with px <= x and py <= y
+    T prefix_sum(C x, C y) const {
+        T sum = 0;
+        for (size_type i = std::upper_bound(X.begin(), X.end(), x) - X.begin(); i > 0; i -= LSB(i)) {
+            const auto b = start[i];
+            for (size_type j = std::upper_bound(Y.begin() + b, Y.begin() + start[i + 1], y) - Y.begin() - b; j > 0; j -= LSB(j))
+                sum += A[b + j - 1];
+        }
+        return sum;
+    }
+
+    // returns the sum of the points in the rectangle (xi, yi) to (xj, yj),
+    // xi < px <= xj and yi < py <= yj (integral C: pass xi - 1, yi - 1 for closed bounds)
+    T range_sum(C xi, C yi, C xj, C yj) const {
+        auto sum = prefix_sum(xj, yj);
+        sum -= prefix_sum(xi, yj);
+        sum += prefix_sum(xi, yi);
+        sum -= prefix_sum(xj, yi);
+        return sum;
+    }
+
+    // number of stored (node, y) pairs
+    size_type nodes() const { return Y.size(); }
+};
 #endif // FENWICK_TREE_2D_HPP
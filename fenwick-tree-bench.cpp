@@ -0,0 +1,316 @@
+#include <bits/stdc++.h>
+#include "bench.hpp"
+#include "fenwick-tree.hpp"
+#include "mmap-vector.hpp"
+#include "segment-tree-nrec.hpp"
+using namespace std;
+// see bench.hpp for build/run instructions
+// build, add, prefix_sum, range_sum, lower_bound, upper_bound on `Tree`
+template <typename Tree>
+void bench_fenwick(const string &prefix, const vector<int64_t> &src, const vector<size_t> &pos, vector<int64_t> val) {
+    const auto n = src.size(), m = pos.size();
+    auto g = Bench::rng(1);
+    auto q = Bench::ranges(n, m, 2);
+    auto bytes = Bench::live_bytes();
+    auto ft = Bench::build((prefix + "/build").c_str(), n, [&]() { return Tree(src); });
+    bytes = Bench::live_bytes() - bytes;
+    if constexpr (requires { Tree(src, 0u); })
+        Bench::build((prefix + "/build(parallel)").c_str(), n, [&]() { return Tree(src, 0u); });
+    Bench::run((prefix + "/add").c_str(), n, m, bytes, [&]() {
+        for (size_t i = 0; i < m; ++i)
+            ft.add(pos[i], val[i]);
+    });
+    Bench::run((prefix + "/prefix_sum").c_str(), n, m, bytes, [&]() {
+        int64_t acc = 0;
+        for (auto i: pos)
+            acc += ft.prefix_sum(i);
+        Bench::keep(acc);
+    });
+    Bench::run((prefix + "/range_sum").c_str(), n, m, bytes, [&]() {
+        int64_t acc = 0;
+        for (auto [l, r]: q)
+            acc += ft.range_sum(l, r - 1 > l ? r - 1 : l);
+        Bench::keep(acc);
+    });
+    if constexpr (requires { ft.add_batch(span<const size_t>(), span<const int64_t>()); }) {
+        // ingest-style batches of 1e5 sorted indices (sorting not timed)
+        const size_t batch = 100'000;
+        auto spos = pos;
+        for (size_t i = 0; i < m; i += batch)
+            sort(spos.begin() + i, spos.begin() + min(m, i + batch));
+        Bench::run((prefix + "/add_batch").c_str(), n, m, bytes, [&]() {
+            for (size_t i = 0; i < m; i += batch) {
+                const auto k = min(batch, m - i);
+                ft.add_batch(span<const size_t>(spos.data() + i, k), span<const int64_t>(val.data() + i, k));
+            }
+        });
+        vector<int64_t> out(batch);
+        Bench::run((prefix + "/prefix_sum_batch").c_str(), n, m, bytes, [&]() {
+            for (size_t i = 0; i < m; i += batch) {
+                const auto k = min(batch, m - i);
+                ft.prefix_sum_batch(span<const size_t>(spos.data() + i, k), span<int64_t>(out.data(), k));
+                Bench::keep(out.data());
+            }
+        });
+    }
+    const auto total = ft.prefix_sum(n - 1);
+    for (auto &x: val)
+        x = g() % (total + 1);
+    Bench::run((prefix + "/lower_bound").c_str(), n, m, bytes, [&]() {
+        size_t acc = 0;
+        for (auto x: val)
+            acc += ft.lower_bound(x);
+        Bench::keep(acc);
+    });
+    Bench::run((prefix + "/upper_bound").c_str(), n, m, bytes, [&]() {
+        size_t acc = 0;
+        for (auto x: val)
+            acc += ft.upper_bound(x);
+        Bench::keep(acc);
+    });
+}
+// `threads` writers share m random adds while one reader keeps calling prefix_sum and
+// lower_bound; ns/op is wall time per add (drops as writers are added if it scales)
+template <typename Add>
+void bench_writers(const string &name, size_t n, unsigned threads, size_t bytes, const vector<size_t> &pos, Add add, auto read) {
+    const auto m = pos.size();
+    atomic<bool> stop = false;
+    thread reader([&]() {
+        size_t acc = 0;
+        while (!stop.load(memory_order_relaxed))
+            acc += read();
+        Bench::keep(acc);
+    });
+    Bench::run(name.c_str(), n, m, bytes, [&]() {
+        vector<thread> pool;
+        for (unsigned t = 0; t < threads; ++t)
+            pool.emplace_back([&, t]() {
+                for (size_t i = t; i < m; i += threads)
+                    add(t, pos[i]);
+            });
+        for (auto &th: pool)
+            th.join();
+    });
+    stop = true;
+    reader.join();
+}
+int main(int argc, char *argv[]) {
+    Bench::header();
+    for (auto n: Bench::sizes(argc, argv)) {
+        const auto m = Bench::ops(n);
+        vector<int64_t> src(n);
+        auto g = Bench::rng();
+        for (auto &x: src)
+            x = g() % 1000;
+        vector<size_t> pos(m);
+        vector<int64_t> val(m);
+        for (size_t i = 0; i < m; ++i) {
+            pos[i] = g() % n;
+            val[i] = g() % 1000;
+        }
+        bench_fenwick<FenwickTree<int64_t>>("fenwick", src, pos, val);
+        bench_fenwick<FenwickTreeBlocked<int64_t>>("fenwick-blocked", src, pos, val);
+        {
+            // histogram counters: 16-bit elements packed by level vs FenwickTree<int64_t>
+            auto ft = Bench::build("fenwick-compact16/build", n, [&]() { return FenwickTreeCompact<16>(src); });
+            const auto bytes = ft.bytes();
+            Bench::run("fenwick-compact16/add", n, m, bytes, [&]() {
+                for (auto i: pos)
+                    ft.add(i, 1);
+            });
+            Bench::run("fenwick-compact16/prefix_sum", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto i: pos)
+                    acc += ft.prefix_sum(i);
+                Bench::keep(acc);
+            });
+            const auto total = ft.prefix_sum(n - 1);
+            vector<int64_t> thr(m);
+            for (auto &x: thr)
+                x = g() % (total + 1);
+            Bench::run("fenwick-compact16/lower_bound", n, m, bytes, [&]() {
+                size_t acc = 0;
+                for (auto x: thr)
+                    acc += ft.lower_bound(x);
+                Bench::keep(acc);
+            });
+        }
+        if (n <= 10'000'000) {
+            // persistent counters: build into a mapped file, then reopen it (warm start)
+            // instead of rebuilding; bytes/elem is heap only, the file holds 8 B/elem.
+            // Beyond the kernel's dirty page budget random adds run at writeback speed.
+            typedef mmap_vector<int64_t> MV;
+            const auto path = (filesystem::temp_directory_path() / "fenwick-tree-bench.bin").string();
+            Bench::build("fenwick-mmap/build", n, [&]() {
+                auto v = MV::create(path, n);
+                copy(src.begin(), src.end(), v.begin());
+                FenwickTree<int64_t, MV> ft(std::move(v));
+                return 0;
+            });
+            auto ft = Bench::build("fenwick-mmap/reopen", n, [&]() { return FenwickTree<int64_t, MV>(in_place, MV::open(path)); });
+            Bench::run("fenwick-mmap/add", n, m, 0, [&]() {
+                for (size_t i = 0; i < m; ++i)
+                    ft.add(pos[i], val[i]);
+            });
+            Bench::run("fenwick-mmap/prefix_sum", n, m, 0, [&]() {
+                int64_t acc = 0;
+                for (auto i: pos)
+                    acc += ft.prefix_sum(i);
+                Bench::keep(acc);
+            });
+            const FenwickTree<int64_t, MV> ro(in_place, MV::open(path, false));
+            Bench::run("fenwick-mmap/prefix_sum(read-only)", n, m, 0, [&]() {
+                int64_t acc = 0;
+                for (auto i: pos)
+                    acc += ro.prefix_sum(i);
+                Bench::keep(acc);
+            });
+            filesystem::remove(path);
+        }
+        {
+            // range add + range sum: V1 (two trees), V2 (one tree of pairs), lazy segment tree
+            auto q = Bench::ranges(n, m, 5);
+            auto bytes = Bench::live_bytes();
+            auto v1 = Bench::build("fenwick-rurq-v1/build", n, [&]() {
+                V1::FenwickTreeRangeUpdateRangeQuery<int64_t> t(n);
+                for (size_t i = 0; i < n; ++i)
+                    t.add_range(i, i, src[i]);
+                return t;
+            });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("fenwick-rurq-v1/add_range", n, m, bytes, [&]() {
+                for (auto [l, r]: q)
+                    v1.add_range(l, r - 1, 1);
+            });
+            Bench::run("fenwick-rurq-v1/range_sum", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q)
+                    acc += v1.range_sum(l, r - 1);
+                Bench::keep(acc);
+            });
+            bytes = Bench::live_bytes();
+            auto v2 = Bench::build("fenwick-rurq-v2/build", n, [&]() { return V2::FenwickTreeRangeUpdateRangeQuery<int64_t>(src); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("fenwick-rurq-v2/add_range", n, m, bytes, [&]() {
+                for (auto [l, r]: q)
+                    v2.add_range(l, r - 1, 1);
+            });
+            Bench::run("fenwick-rurq-v2/range_sum", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q)
+                    acc += v2.range_sum(l, r - 1);
+                Bench::keep(acc);
+            });
+            const auto total = v2.prefix_sum(n - 1);
+            vector<int64_t> thr(m);
+            for (auto &x: thr)
+                x = g() % (total + 1);
+            Bench::run("fenwick-rurq-v2/lower_bound", n, m, bytes, [&]() {
+                size_t acc = 0;
+                for (auto x: thr)
+                    acc += v2.lower_bound(x);
+                Bench::keep(acc);
+            });
+            bytes = Bench::live_bytes();
+            auto st = Bench::build("segtree-lazy-sum-add/build", n, [&]() { return SegmentTree::RangeUpdateRangeQueryLazy::SegTreeSumAdd<vector<int64_t>>(src.cbegin(), src.cend()); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("segtree-lazy-sum-add/update_halfopen", n, m, bytes, [&]() {
+                for (auto [l, r]: q)
+                    st.update_halfopen(l, r, 1);
+            });
+            Bench::run("segtree-lazy-sum-add/query_halfopen", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q)
+                    acc += st.query_halfopen(l, r);
+                Bench::keep(acc);
+            });
+        }
+        if (n <= 1'000'000) {
+            // shared counters: FenwickTree behind a mutex vs FenwickTreeConcurrent, unsharded and one shard per writer
+            for (unsigned threads = 1; threads <= 64; threads *= 2) {
+                const auto suffix = "/add(" + to_string(threads) + "w+1r)";
+                {
+                    FenwickTree<uint64_t> ft(n);
+                    mutex mx;
+                    bench_writers("fenwick-mutex" + suffix, n, threads, n*sizeof(uint64_t), pos,
+                            [&](unsigned, size_t i) { lock_guard lk(mx); ft.add(i, 1); },
+                            [&]() { lock_guard lk(mx); return ft.prefix_sum(n - 1) + ft.lower_bound(n/2); });
+                }
+                {
+                    FenwickTreeConcurrent<uint64_t> ft(n);
+                    bench_writers("fenwick-concurrent" + suffix, n, threads, n*sizeof(uint64_t), pos,
+                            [&](unsigned, size_t i) { ft.add(i, 1); },
+                            [&]() { return ft.prefix_sum(n - 1) + ft.lower_bound(n/2); });
+                }
+                {
+                    FenwickTreeConcurrent<uint64_t> ft(n, threads);
+                    bench_writers("fenwick-sharded" + suffix, n, threads, threads*n*sizeof(uint64_t), pos,
+                            [&](unsigned t, size_t i) { ft.add(i, 1, t); },
+                            [&]() { return ft.prefix_sum(n - 1) + ft.lower_bound(n/2); });
+                }
+            }
+        }
+        if (n <= 10'000'000) {
+            // 8 metrics over the same indices: 8 separate trees vs one interleaved tree
+            constexpr size_t K = 8;
+            typedef FenwickTreeMulti<int64_t, K>::value_type lanes;
+            vector<int64_t> flat(n*K);
+            for (auto &x: flat)
+                x = g() % 1000;
+            auto bytes = Bench::live_bytes();
+            auto sep = Bench::build("fenwick-x8/build", n, [&]() {
+                array<FenwickTree<int64_t>, K> res;
+                for (size_t k = 0; k < K; ++k) {
+                    vector<int64_t> col(n);
+                    for (size_t i = 0; i < n; ++i)
+                        col[i] = flat[i*K + k];
+                    res[k] = FenwickTree<int64_t>(std::move(col));
+                }
+                return res;
+            });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("fenwick-x8/add", n, m, bytes, [&]() {
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t k = 0; k < K; ++k)
+                        sep[k].add(pos[i], int64_t(k + i));
+            });
+            Bench::run("fenwick-x8/prefix_sum", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto i: pos)
+                    for (size_t k = 0; k < K; ++k)
+                        acc += sep[k].prefix_sum(i);
+                Bench::keep(acc);
+            });
+            bytes = Bench::live_bytes();
+            auto multi = Bench::build("fenwick-multi8/build", n, [&]() { return FenwickTreeMulti<int64_t, K>(flat); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("fenwick-multi8/add", n, m, bytes, [&]() {
+                for (size_t i = 0; i < m; ++i) {
+                    lanes d;
+                    for (size_t k = 0; k < K; ++k)
+                        d[k] = k + i;
+                    multi.add(pos[i], d);
+                }
+            });
+            Bench::run("fenwick-multi8/prefix_sum", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto i: pos)
+                    for (auto s: multi.prefix_sum(i))
+                        acc += s;
+                Bench::keep(acc);
+            });
+            const auto total0 = multi.prefix_sum(n - 1, 0);
+            vector<int64_t> thr(m);
+            for (auto &x: thr)
+                x = g() % (total0 + 1);
+            Bench::run("fenwick-multi8/lower_bound(lane)", n, m, bytes, [&]() {
+                size_t acc = 0;
+                for (auto x: thr)
+                    acc += multi.lower_bound(x, 0);
+                Bench::keep(acc);
+            });
+        }
+    }
+    return 0;
+}
+// vim: sw=4 et
@@ -0,0 +1,132 @@
+#include <bits/stdc++.h>
+#include "bench.hpp"
+#include "fenwick-tree-generic.hpp"
+using namespace std;
+// see bench.hpp for build/run instructions
+struct OpSum { void operator() (int64_t &a, int64_t b) const { a += b; } };
+struct OpMax { void operator() (int64_t &a, int64_t b) const { if (a < b) a = b; } };
+int main(int argc, char *argv[]) {
+    Bench::header();
+    for (auto n: Bench::sizes(argc, argv)) {
+        const auto m = Bench::ops(n);
+        vector<int64_t> src(n);
+        auto g = Bench::rng();
+        for (auto &x: src)
+            x = g() % 1000;
+        vector<size_t> pos(m);
+        vector<int64_t> val(m);
+        for (size_t i = 0; i < m; ++i) {
+            pos[i] = g() % n;
+            val[i] = g() % 1000;
+        }
+        auto q = Bench::ranges(n, m, 2);
+        {
+            auto bytes = Bench::live_bytes();
+            auto ft = Bench::build("fenwick-generic-sum/build", n, [&]() { return FenwickGeneric<vector<int64_t>, OpSum>(src); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("fenwick-generic-sum/add", n, m, bytes, [&]() {
+                for (size_t i = 0; i < m; ++i)
+                    ft.add(pos[i], val[i]);
+            });
+            Bench::run("fenwick-generic-sum/prefix_sum", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto i: pos)
+                    acc += ft.prefix_sum(i);
+                Bench::keep(acc);
+            });
+            {
+                // ingest-style batches of 1e5 sorted indices (sorting not timed)
+                const size_t batch = 100'000;
+                auto spos = pos;
+                for (size_t i = 0; i < m; i += batch)
+                    sort(spos.begin() + i, spos.begin() + min(m, i + batch));
+                Bench::run("fenwick-generic-sum/add_batch", n, m, bytes, [&]() {
+                    for (size_t i = 0; i < m; i += batch) {
+                        const auto k = min(batch, m - i);
+                        ft.add_batch(span<const size_t>(spos.data() + i, k), span<const int64_t>(val.data() + i, k));
+                    }
+                });
+                vector<int64_t> out(batch);
+                Bench::run("fenwick-generic-sum/prefix_sum_batch", n, m, bytes, [&]() {
+                    for (size_t i = 0; i < m; i += batch) {
+                        const auto k = min(batch, m - i);
+                        ft.prefix_sum_batch(span<const size_t>(spos.data() + i, k), span<int64_t>(out.data(), k));
+                        Bench::keep(out.data());
+                    }
+                });
+            }
+            Bench::run("fenwick-generic-sum/range_sum", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q) {
+                    auto s = ft.range_sum(l, r - 1 > l ? r - 1 : l);
+                    acc += s.first - s.second;
+                }
+                Bench::keep(acc);
+            });
+            const auto total = ft.prefix_sum(n - 1);
+            vector<int64_t> thr(m);
+            for (auto &x: thr)
+                x = g() % (total + 1);
+            Bench::run("fenwick-generic-sum/lower_bound", n, m, bytes, [&]() {
+                size_t acc = 0;
+                for (auto x: thr)
+                    acc += ft.lower_bound(x);
+                Bench::keep(acc);
+            });
+        }
+        {
+            auto bytes = Bench::live_bytes();
+            auto ft = Bench::build("fenwick-generic-max/build", n, [&]() { return FenwickGeneric<vector<int64_t>, OpMax>(src); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("fenwick-generic-max/add", n, m, bytes, [&]() {
+                for (size_t i = 0; i < m; ++i)
+                    ft.add(pos[i], val[i]);
+            });
+            Bench::run("fenwick-generic-max/prefix_sum", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto i: pos)
+                    acc += ft.prefix_sum(i);
+                Bench::keep(acc);
+            });
+            Bench::run("fenwick-generic-max/upper_bound", n, m, bytes, [&]() {
+                size_t acc = 0;
+                for (auto x: val)
+                    acc += ft.upper_bound(x);
+                Bench::keep(acc);
+            });
+        }
+        {
+            // ready-made ops: traits pick range_query() by subtraction for Plus,
+            // element walk (with kept elements) and early-exit add() for Max
+            auto bytes = Bench::live_bytes();
+            auto ft = Bench::build("fenwick-ops-plus/build", n, [&]() { return FenwickGeneric<vector<int64_t>, FenwickOps::Plus<int64_t>>(src); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("fenwick-ops-plus/range_query", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q)
+                    if (l + 1 < r)
+                        acc += ft.range_query(l, r - 1);
+                Bench::keep(acc);
+            });
+        }
+        {
+            typedef FenwickGeneric<vector<int64_t>, FenwickOps::Max<int64_t>, true> Tree;
+            auto bytes = Bench::live_bytes();
+            auto ft = Bench::build("fenwick-ops-max/build", n, [&]() { return Tree(src); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("fenwick-ops-max/add", n, m, bytes, [&]() {
+                for (size_t i = 0; i < m; ++i)
+                    ft.add(pos[i], val[i]);
+            });
+            Bench::run("fenwick-ops-max/range_query", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q)
+                    if (l + 1 < r)
+                        acc += ft.range_query(l, r - 1);
+                Bench::keep(acc);
+            });
+        }
+    }
+    return 0;
+}
+// vim: sw=4 et
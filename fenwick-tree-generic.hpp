@@ -1,7 +1,66 @@
 #ifndef FENWICK_TREE_GENERIC_HPP
 #define FENWICK_TREE_GENERIC_HPP
 #include <algorithm>
-template <typename V, typename Op>
+#include <concepts>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+// Compile-time properties of a FenwickGeneric Op over value_type T, detected from the Op:
+//	invertible   -- has `void inverse(T &a, const T &b) const` (a = a op b^-1, a group)
+//	idempotent   -- `static constexpr bool idempotent = true` (a op a == a, e.g. min, max);
+//	                lets add() stop early, range_query() does not use it
+//	vectorizable -- `static constexpr bool vectorizable = true` (op on a plain loop over
+//	                contiguous values is turned into SIMD by the compiler); only read by
+//	                range_query() for ops that are not invertible
+// Specialize FenwickOpTraits to describe an Op that cannot be changed.
+template <typename Op, typename T>
+struct FenwickOpTraits {
+	static constexpr bool invertible = requires(const Op &op, T &a, const T &b) { op.inverse(a, b); };
+	static constexpr bool idempotent = requires { requires Op::idempotent; };
+	static constexpr bool vectorizable = requires { requires Op::vectorizable; };
+};
+// ready-made ops
+namespace FenwickOps {
+	template <typename T>
+	struct Plus {
+		void operator() (T &a, const T &b) const { a += b; }
+		void inverse(T &a, const T &b) const { a -= b; }
+	};
+	template <std::integral T>
+	struct Xor {
+		void operator() (T &a, const T &b) const { a ^= b; }
+		void inverse(T &a, const T &b) const { a ^= b; }
+	};
+	template <typename T>
+	struct Min {
+		static constexpr bool idempotent = true;
+		static constexpr bool vectorizable = std::is_arithmetic_v<T>;
+		void operator() (T &a, const T &b) const { a = std::min(a, b); }
+	};
+	template <typename T>
+	struct Max {
+		static constexpr bool idempotent = true;
+		static constexpr bool vectorizable = std::is_arithmetic_v<T>;
+		void operator() (T &a, const T &b) const { a = std::max(a, b); }
+	};
+	// multiplication modulo M; inverse() (Fermat) requires M prime and all values non-zero mod M
+	template <std::unsigned_integral T, T M>
+	struct ModMul {
+		typedef std::conditional_t<sizeof(T) <= 4, std::uint64_t, unsigned __int128> wide_type;
+		void operator() (T &a, const T &b) const { a = static_cast<wide_type>(a)*b % M; }
+		void inverse(T &a, const T &b) const {
+			T r = 1, x = b;
+			for (T e = M - 2; e; e >>= 1, (*this)(x, x))
+				if (e & 1)
+					(*this)(r, x);
+			(*this)(a, r);
+		}
+	};
+}
+// Elements == true keeps a copy of the elements next to the tree (twice the memory),
+// needed by range_query() for ops that are not invertible
+template <typename V, typename Op, bool Elements = false>
 class FenwickGeneric {
 	// V must be container type with
 	// ```
@@ -39,11 +98,15 @@ class FenwickGeneric {
 	// prefix modulo product:
 	//  Fenwick f(vector<int>(size, 1), [m](auto &a, auto b) { a = a*static_cast<int64_t>(b) % m; }, true);
 	V A;
+	struct NoElements {};
+	[[no_unique_address]]
+	std::conditional_t<Elements, V, NoElements> E;
 	[[no_unique_address]]
 	Op op;
 	public:
 	typedef typename V::value_type value_type;
 	typedef typename V::size_type size_type;
+	typedef FenwickOpTraits<Op, value_type> traits;
 	private:
 	// return least significant bit of i
 	static size_type LSB(size_type i) {
@@ -60,22 +123,120 @@ class FenwickGeneric {
 	// set no_init to true if A consists of only neutral element
 	// (0 for addition, 1 for multiplication, equal values for min/max)
 	// time = no_init ? O(1) : O(n)
-	FenwickGeneric(V &&A, Op op = Op{}, bool no_init = false):A{A}, op{op} { if (!no_init) init(); }
+	FenwickGeneric(V &&A, Op op = Op{}, bool no_init = false):A{std::move(A)}, op{op} {
+		if constexpr (Elements)
+			E = this->A;
+		if (!no_init)
+			init();
+	}
 	// time = O(n)
-	FenwickGeneric(const V &A, Op op = Op{}, bool no_init = false):A{A}, op{op} { if (!no_init) init(); }
+	FenwickGeneric(const V &A, Op op = Op{}, bool no_init = false):A{A}, op{op} {
+		if constexpr (Elements)
+			E = A;
+		if (!no_init)
+			init();
+	}
 	constexpr auto size() const { return A.size(); }
 	constexpr auto empty() const { return A.empty(); }
 	// requires `op(current_value, v), current_value == new_value`
 	// for op == max v must be equal or greater than current value
 	// for op == min v must be equal or less than current value
+	// for idempotent ops the walk stops at the first node v does not change:
+	// every node above it covers that node's elements, so it cannot change either
 	// time = O(log n)
 	void add(size_type idx, const value_type &v) {
+		if constexpr (Elements)
+			op(E[idx], v);
 		if (idx == 0) {
 			op(A[0], v);
 			return;
 		}
-		for (; idx < A.size(); idx += LSB(idx))
-			op(A[idx], v);
+		for (; idx < A.size(); idx += LSB(idx)) {
+			if constexpr (traits::idempotent) {
+				const auto before = A[idx];
+				op(A[idx], v);
+				if (A[idx] == before)
+					break;
+			} else {
+				op(A[idx], v);
+			}
+		}
+	}
+	// add_batch() with at least size()/dense_batch_ratio updates takes an O(n) pass instead
+	static constexpr size_type dense_batch_ratio = 4;
+	// add(idx[k], v[k]) for all k; idx must be sorted (duplicates allowed)
+	// the update paths are merged (pending nodes form one ancestor chain, kept on a stack),
+	// every touched node gets one op()
+	// time = O(min(k log n, n))
+	void add_batch(std::span<const size_type> idx, std::span<const value_type> v) {
+		const size_type n = A.size();
+		if constexpr (Elements)
+			for (size_type k = 0; k < idx.size(); ++k)
+				op(E[idx[k]], v[k]);
+		if (idx.size()*dense_batch_ratio >= n) {
+			// build a tree of the batch alone (no neutral element needed: `has` marks set nodes)
+			// and op() it into A node by node
+			std::vector<value_type> D(n);
+			std::vector<char> has(n);
+			for (size_type k = 0; k < idx.size(); ++k) {
+				if (has[idx[k]]) {
+					op(D[idx[k]], v[k]);
+				} else {
+					D[idx[k]] = v[k];
+					has[idx[k]] = true;
+				}
+			}
+			if (has[0])
+				op(A[0], D[0]);
+			for (size_type i = 1; i < n; ++i) {
+				if (!has[i])
+					continue;
+				op(A[i], D[i]);
+				if (auto j = i + LSB(i); j < n) {
+					if (has[j]) {
+						op(D[j], D[i]);
+					} else {
+						D[j] = D[i];
+						has[j] = true;
+					}
+				}
+			}
+			return;
+		}
+		size_type node[sizeof(size_type)*8 + 1];
+		value_type acc[sizeof(size_type)*8 + 1];
+		size_type top = 0;
+		// apply pending nodes below `limit`, passing their values to the parents
+		auto flush = [&](size_type limit) {
+			while (top && node[top - 1] < limit) {
+				const auto q = node[--top];
+				op(A[q], acc[top]);
+				if (const auto p = q + LSB(q); p < n) {
+					if (top && node[top - 1] == p) {
+						op(acc[top - 1], acc[top]);
+					} else {
+						node[top] = p;
+						++top;
+					}
+				}
+			}
+		};
+		for (size_type k = 0; k < idx.size(); ++k) {
+			const auto i = idx[k];
+			if (i == 0) {
+				op(A[0], v[k]);
+				continue;
+			}
+			flush(i);
+			if (top && node[top - 1] == i) {
+				op(acc[top - 1], v[k]);
+			} else {
+				node[top] = i;
+				acc[top] = v[k];
+				++top;
+			}
+		}
+		flush(n);
 	}
 	// return op(A[0], op(A[1], op(A[2], ... op(A[idx - 1], A[idx]))))
 	// time = O(log idx)
@@ -85,6 +246,11 @@ class FenwickGeneric {
 			op(v, A[idx]);
 		return v;
 	}
+	// out[k] = prefix_sum(idx[k]) for all k
+	void prefix_sum_batch(std::span<const size_type> idx, std::span<value_type> out) const {
+		for (size_type k = 0; k < idx.size(); ++k)
+			out[k] = prefix_sum(idx[k]);
+	}
 	// v = range_sum(i, j); r.first = op(r.second, op(...op(A[i + 1], A[i + 2]), ... A[j]));
 	// if inverse() operation defined, we can calculate
 	// op(...op(A[i + 1], A[i + 2), ... A[j]) as op(v.first, inverse(v.second))
@@ -101,10 +267,47 @@ class FenwickGeneric {
 		return sum;
 	}
 
+	// op(A[i + 1], A[i + 2], ... A[j]) (elements, not nodes), i < j, algorithm picked by traits:
+	// invertible: both prefix walks of range_sum() and one inverse(), O(log n)
+	// otherwise (requires Elements): walk down from j taking node j when it lies inside
+	// (i; j] and element j when it does not, O(log^2 n) worst case; for vectorizable ops
+	// a short remainder is folded with one flat loop over the elements
+	// idempotent ops (Min, Max) take the same element walk, ~1 us at 1e7 elements; there is
+	// no faster path for them here (that would take e.g. a sparse table next to the tree)
+	value_type range_query(size_type i, size_type j) const {
+		if constexpr (traits::invertible) {
+			auto sum = range_sum(i, j);
+			op.inverse(sum.first, sum.second);
+			return sum.first;
+		} else {
+			static_assert(Elements, "range_query() for a non-invertible op needs FenwickGeneric<V, Op, true>");
+			auto res = j - LSB(j) >= i ? A[j] : E[j];
+			j = j - LSB(j) >= i ? j - LSB(j) : j - 1;
+			while (j > i) {
+				if constexpr (traits::vectorizable) {
+					if (j - i <= 32) {
+						for (auto k = i + 1; k <= j; ++k)
+							op(res, E[k]);
+						break;
+					}
+				}
+				if (j - LSB(j) >= i) {
+					op(res, A[j]);
+					j -= LSB(j);
+				} else {
+					op(res, E[j--]);
+				}
+			}
+			return res;
+		}
+	}
+
 	template <class... Args>
 	void emplace_back(Args&&...args) {
 		auto cidx = A.size();
 		auto &back = A.emplace_back(std::forward<Args>(args)...);
+		if constexpr (Elements)
+			E.push_back(back);
 		if (!cidx)
 			return;
 		for (auto j = cidx - 1; j + LSB(j) == cidx; j -= LSB(j))
@@ -120,6 +323,8 @@ class FenwickGeneric {
 
 	void pop_back() {
 		A.pop_back();
+		if constexpr (Elements)
+			E.pop_back();
 	}
 
 	private:
@@ -137,18 +342,25 @@ class FenwickGeneric {
 	template <class Iterator>
 	void append(Iterator begin, Iterator end) {
 		auto osize = A.size();
-		for (; begin != end; ++begin)
+		for (; begin != end; ++begin) {
 			A.push_back(*begin);
+			if constexpr (Elements)
+				E.push_back(A.back());
+		}
 		adjust_size(osize);
 	}
 
 	void reserve(size_type size) {
 		A.reserve(size);
+		if constexpr (Elements)
+			E.reserve(size);
 	}
 
 	void resize(size_type size, const value_type& default_value) {
 		auto osize = A.size();
 		A.resize(size, default_value);
+		if constexpr (Elements)
+			E.resize(size, default_value);
 		if (size > osize)
 			adjust_size(osize);
 	}
@@ -156,16 +368,21 @@ class FenwickGeneric {
 	void resize(size_type size) {
 		auto osize = A.size();
 		A.resize(size);
+		if constexpr (Elements)
+			E.resize(size);
 		if (size > osize)
 			adjust_size(osize);
 	}
 
 	void reset(size_type size, const value_type& default_value, bool no_init = false) {
-		auto n = A.size();
 		A.clear();
-		A.resize(n, default_value);
+		A.resize(size, default_value);
+		if constexpr (Elements) {
+			E.clear();
+			E.resize(size, default_value);
+		}
 		if (!no_init)
-			init(A);
+			init();
 	}
 
 	// search for first index such that prefix_sum(idx) > key and idx < j,
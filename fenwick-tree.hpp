@@ -1,5 +1,15 @@
 #ifndef FENWICK_TREE_HPP
 #define FENWICK_TREE_HPP
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 template <typename T, typename V = std::vector<T>>
 class FenwickTree {
@@ -25,6 +35,39 @@ class FenwickTree {
         }
     }
 
+    // Same as init(A) on `threads` threads (0: std::thread::hardware_concurrency()).
+    // A[1..] is split into chunks (lo; lo + c] with c a power of two; inside a chunk every
+    // update stays in the chunk, except the one from its last element A[lo + c], and those
+    // form a Fenwick tree over multiples of c that is finished on the calling thread.
+    static void init(V &A, unsigned threads) {
+        const size_type n = A.size();
+        if (!threads)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        if (threads == 1 || n < 4096)
+            return init(A);
+        size_type c = 1;
+        while (c*threads < n)
+            c <<= 1;
+        auto chunk = [&A, n, c](size_type lo) {
+            for (size_type i = lo + 1; i < std::min(lo + c, n); ++i) {
+                auto j = i + LSB(i);
+                if (j < n)
+                    A[j] += A[i];
+            }
+        };
+        {
+            std::vector<std::jthread> pool;
+            for (size_type lo = c; lo < n; lo += c)
+                pool.emplace_back(chunk, lo);
+            chunk(0);
+        }
+        for (size_type i = c; i < n; i += c) {
+            auto j = i + LSB(i);
+            if (j < n)
+                A[j] += A[i];
+        }
+    }
+
     // Convert back to array of per-element counts
     static void fini(V &A) {
         for (size_type i = A.size(); i-- > 1;) {
@@ -45,6 +88,20 @@ class FenwickTree {
         init(A);
     }
 
+    // parallel build on `threads` threads (0: std::thread::hardware_concurrency())
+    FenwickTree(const V &nums, unsigned threads):A(nums) {
+        init(A, threads);
+    }
+
+    FenwickTree(V &&nums, unsigned threads):A(std::move(nums)) {
+        init(A, threads);
+    }
+
+    // adopt `tree` as is: it is already in tree form (e.g. a reopened mmap_vector),
+    // and so is an all-zero one
+    FenwickTree(std::in_place_t, V &&tree):A(std::move(tree)) {
+    }
+
     FenwickTree(const FenwickTree &) = default;
     FenwickTree(FenwickTree &&) = default;
 
@@ -94,6 +151,64 @@ class FenwickTree {
             A[i] += delta;
     }
 
+    // add_batch() with at least size()/dense_batch_ratio updates rebuilds in O(n) instead
+    // (fini(), apply, init(); T must support 'a -= b')
+    static constexpr size_type dense_batch_ratio = 4;
+
+    // add(idx[k], delta[k]) for all k; idx must be sorted (duplicates allowed).
+    // The update paths are merged: the pending nodes always form one ancestor chain,
+    // so they fit a stack of log n entries and every touched node is written once.
+    void add_batch(std::span<const size_type> idx, std::span<const T> delta) {
+        const size_type n = A.size();
+        if (idx.size()*dense_batch_ratio >= n) {
+            fini(A);
+            for (size_type k = 0; k < idx.size(); ++k)
+                A[idx[k]] += delta[k];
+            init(A);
+            return;
+        }
+        size_type node[sizeof(size_type)*8 + 1];
+        T acc[sizeof(size_type)*8 + 1];
+        size_type top = 0;
+        // write out pending nodes below `limit`, passing their deltas to the parents
+        auto flush = [&](size_type limit) {
+            while (top && node[top - 1] < limit) {
+                const auto q = node[--top];
+                A[q] += acc[top];
+                if (const auto p = q + LSB(q); p < n) {
+                    if (top && node[top - 1] == p) {
+                        acc[top - 1] += acc[top];
+                    } else {
+                        node[top] = p;
+                        ++top;
+                    }
+                }
+            }
+        };
+        for (size_type k = 0; k < idx.size(); ++k) {
+            const auto i = idx[k];
+            if (i == 0) {
+                A[0] += delta[k];
+                continue;
+            }
+            flush(i);
+            if (top && node[top - 1] == i) {
+                acc[top - 1] += delta[k];
+            } else {
+                node[top] = i;
+                acc[top] = delta[k];
+                ++top;
+            }
+        }
+        flush(n);
+    }
+
+    // out[k] = prefix_sum(idx[k]) for all k
+    void prefix_sum_batch(std::span<const size_type> idx, std::span<T> out) const {
+        for (size_type k = 0; k < idx.size(); ++k)
+            out[k] = prefix_sum(idx[k]);
+    }
+
     // Returns sum of nums[i + 1] to nums[j].
     // Same as prefix_sum(j) - prefix_sum(i), but a bit faster
     T range_sum(size_type i, size_type j) const {
@@ -122,7 +237,7 @@ class FenwickTree {
     template <class... Args>
     void emplace_back(Args&&...args) {
         auto cidx = A.size();
-        auto &back = A.emplace_back(forward<Args>(args)...);
+        auto &back = A.emplace_back(std::forward<Args>(args)...);
         if (!cidx)
             return;
         for (auto j = cidx - 1; j + LSB(j) == cidx; j -= LSB(j))
@@ -191,7 +306,7 @@ class FenwickTree {
 	size_type res = 0;
         for (; j > 0; j >>= 1)
 	    if (auto p = res + j; p < i)
-		if (auto t = s; !(value < (t += A[k]))) {
+		if (auto t = s; !(value < (t += A[p]))) {
 		    s = t;
 		    res = p;
 		    }
@@ -218,7 +333,7 @@ class FenwickTree {
 	size_type res = 0;
         for (; j > 0; j >>= 1)
 	    if (auto p = res + j; p < i)
-		if (auto t = s; (t += A[k]) < value) {
+		if (auto t = s; (t += A[p]) < value) {
 		    s = t;
 		    res = p;
 		}
@@ -233,11 +348,34 @@ class FenwickTree {
     size_type lower_bound(T value) const {
         return lower_bound(value, size());
     }
+
+    // Find the minimum idx with pred(prefix_sum(idx), idx), size() if none.
+    // Requires: pred is false ... false true ... true over idx
+    // O(log n)
+    template <typename Pred>
+    size_type search(Pred pred) const {
+        if (A.empty())
+            return 0;
+        auto s = A[0];
+        if (pred(std::as_const(s), size_type(0)))
+            return 0;
+        size_type res = 0;
+        for (size_type j = std::bit_floor(A.size()); j > 0; j >>= 1)
+            if (auto p = res + j; p < A.size())
+                if (auto t = s; !pred(std::as_const(t += A[p]), p)) {
+                    s = t;
+                    res = p;
+                }
+        return res + 1;
+    }
     
     constexpr size_type size() const { return A.size(); }
     
     constexpr bool empty() const { return A.empty(); }
 
+    // underlying storage, in tree form (e.g. for mmap_vector::sync())
+    const V &storage() const { return A; }
+
     private:
     struct FenwickReference {
         FenwickTree &f;
@@ -273,6 +411,691 @@ class FenwickTree {
     FenwickReference front() { return (*this)[0]; }
     FenwickReference back() { return (*this)[size() - 1]; }
 };
+// FenwickTree for counters shared between threads, no external lock:
+// add() does relaxed fetch_add on the nodes of its path, readers use relaxed loads.
+// A read racing with adds sees each node either before or after each add, so it is
+// not a snapshot, but with non-negative deltas it is never below the sum at its start
+// (and lower_bound/upper_bound stay within the range of values seen during the call).
+// With shards > 1 every thread adds to its own copy of the tree (threads are assigned
+// round-robin on first use), so writers do not bounce cache lines between cores,
+// and reads merge the shards (shards times the loads).
+// T must be a type std::atomic<T>::fetch_add exists for (integral or floating point).
+template <typename T>
+class FenwickTreeConcurrent {
+    public:
+    typedef std::size_t size_type;
+    typedef T value_type;
+    private:
+    size_type n;
+    unsigned m_shards;
+    size_type stride; // elements per shard, rounded up to whole cache lines
+    std::vector<std::atomic<T>> A; // shard k is A[k*stride .. k*stride + n)
+    static size_type LSB(size_type i) {
+        return i & -i;
+    }
+    T load(size_type i) const {
+        T sum = A[i].load(std::memory_order_relaxed);
+        for (unsigned k = 1; k < m_shards; ++k)
+            sum += A[k*stride + i].load(std::memory_order_relaxed);
+        return sum;
+    }
+    unsigned shard() const {
+        static std::atomic<unsigned> next = 0;
+        thread_local const unsigned s = next.fetch_add(1, std::memory_order_relaxed);
+        return s % m_shards;
+    }
+    public:
+    // shards == 0: std::thread::hardware_concurrency()
+    FenwickTreeConcurrent(size_type size = 0, unsigned shards = 1):n(size),
+        m_shards(shards ? shards : std::max(1u, std::thread::hardware_concurrency())),
+        stride((size*sizeof(T) + 63)/64*64/sizeof(T)), A(m_shards*stride) {
+    }
+
+    // initial values go to shard 0; same O(n) build as FenwickTree
+    template <typename V> requires requires (const V &v) { v.size(); }
+    FenwickTreeConcurrent(const V &nums, unsigned shards = 1):FenwickTreeConcurrent(nums.size(), shards) {
+        for (size_type i = 0; i < n; ++i)
+            A[i].store(nums[i], std::memory_order_relaxed);
+        for (size_type i = 1; i < n; ++i) {
+            auto j = i + LSB(i);
+            if (j < n)
+                A[j].store(A[j].load(std::memory_order_relaxed) + A[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+    FenwickTreeConcurrent(const FenwickTreeConcurrent &) = delete;
+    FenwickTreeConcurrent &operator = (const FenwickTreeConcurrent &) = delete;
+
+    // Add delta to element with index i (zero-based); safe to call from any number of threads
+    void add(size_type i, T delta) {
+        add(i, delta, shard());
+    }
+
+    // same on an explicit shard (e.g. a worker id), shard < shards()
+    void add(size_type i, T delta, unsigned shard) {
+        auto a = A.data() + shard*stride;
+        if (i == 0) {
+            a[0].fetch_add(delta, std::memory_order_relaxed);
+            return;
+        }
+        for (; i < n; i += LSB(i))
+            a[i].fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    // Returns the sum of the first i elements (indices 0 to i)
+    T prefix_sum(size_type i) const {
+        T sum = load(0);
+        for (; i != 0; i -= LSB(i))
+            sum += load(i);
+        return sum;
+    }
+
+    // Returns sum of nums[i + 1] to nums[j].
+    T range_sum(size_type i, size_type j) const {
+        T sum = 0;
+        for (; j > i; j -= LSB(j))
+            sum += load(j);
+        for (; i > j; i -= LSB(i))
+            sum -= load(i);
+        return sum;
+    }
+
+    T get(size_type i) const {
+        return i == 0 ? load(0) : range_sum(i - 1, i);
+    }
+
+    // Same as FenwickTree::upper_bound / lower_bound
+    // Requires: all values are non-negative
+    size_type upper_bound(T value, size_type i) const {
+        auto s = load(0);
+        if (value < s)
+            return 0;
+        size_type res = 0;
+        for (size_type j = i ? std::bit_floor(i) : 0; j > 0; j >>= 1)
+            if (auto p = res + j; p < i)
+                if (auto t = s + load(p); !(value < t)) {
+                    s = t;
+                    res = p;
+                }
+        return res + 1;
+    }
+    size_type upper_bound(T value) const {
+        return upper_bound(value, size());
+    }
+
+    size_type lower_bound(T value, size_type i) const {
+        auto s = load(0);
+        if (!(s < value))
+            return 0;
+        size_type res = 0;
+        for (size_type j = i ? std::bit_floor(i) : 0; j > 0; j >>= 1)
+            if (auto p = res + j; p < i)
+                if (auto t = s + load(p); t < value) {
+                    s = t;
+                    res = p;
+                }
+        return res + 1;
+    }
+    size_type lower_bound(T value) const {
+        return lower_bound(value, size());
+    }
+
+    constexpr size_type size() const { return n; }
+
+    constexpr bool empty() const { return n == 0; }
+
+    unsigned shards() const { return m_shards; }
+};
+// Same interface as FenwickTree, two-level layout for large sizes: the elements are
+// kept as is in blocks of B (one cache line by default), and a one-based Fenwick tree
+// S[1..] holds the block sums (S[k] covers blocks (k - LSB(k); k]). The strided walk
+// runs over n/B nodes only (log2(B) fewer levels, B times smaller, so mostly cached),
+// and the last step is a contiguous sum inside one cache line.
+template <typename T, typename V = std::vector<T>, std::size_t B = std::bit_floor(std::max<std::size_t>(1, 64/sizeof(T)))>
+class FenwickTreeBlocked {
+    static_assert(std::has_single_bit(B), "block size must be a power of two");
+    V A; // elements
+    V S; // Fenwick tree over block sums, S[0] unused
+    public:
+    typedef typename V::size_type size_type;
+    typedef typename V::value_type value_type;
+    private:
+    static const size_type LSB(const size_type i) {
+        return i & -i;
+    }
+    static size_type blocks(size_type n) {
+        return (n + B - 1)/B;
+    }
+    // sum of blocks [0; b)
+    T block_prefix(size_type b) const {
+        T sum = 0;
+        for (; b != 0; b -= LSB(b))
+            sum += S[b];
+        return sum;
+    }
+    void block_add(size_type b, const T &delta) {
+        for (++b; b < S.size(); b += LSB(b))
+            S[b] += delta;
+    }
+    void block_sub(size_type b, const T &delta) {
+        for (++b; b < S.size(); b += LSB(b))
+            S[b] -= delta;
+    }
+    void init() {
+        const auto nb = blocks(A.size());
+        S.assign(nb + 1, T(0));
+        for (size_type b = 0; b < nb; ++b)
+            for (size_type i = b*B; i < std::min(b*B + B, A.size()); ++i)
+                S[b + 1] += A[i];
+        for (size_type k = 1; k <= nb; ++k) {
+            auto j = k + LSB(k);
+            if (j <= nb)
+                S[j] += S[k];
+        }
+    }
+    // first index in [0; i) where pred(prefix_sum(index)) holds, i if none;
+    // pred must be monotone over non-negative elements
+    template <typename Pred>
+    size_type search(size_type i, Pred pred) const {
+        const auto nb = blocks(i);
+        T s = 0;
+        size_type b = 0;
+        for (size_type j = nb ? std::bit_floor(nb) : 0; j > 0; j >>= 1)
+            if (auto p = b + j; p <= nb)
+                if (auto t = s; !pred(t += S[p])) {
+                    s = t;
+                    b = p;
+                }
+        for (size_type k = b*B; k < i; ++k)
+            if (pred(s += A[k]))
+                return k;
+        return i;
+    }
+    public:
+    FenwickTreeBlocked(size_type size = 0):A(size), S(blocks(size) + 1) {
+    }
+
+    FenwickTreeBlocked(const V &nums):A(nums) {
+        init();
+    }
+
+    FenwickTreeBlocked(V &&nums):A(std::move(nums)) {
+        init();
+    }
+
+    FenwickTreeBlocked(const FenwickTreeBlocked &) = default;
+    FenwickTreeBlocked(FenwickTreeBlocked &&) = default;
+
+    FenwickTreeBlocked &operator = (const V & A) {
+        this->A = A;
+        init();
+        return *this;
+    }
+
+    FenwickTreeBlocked &operator = (V && A) {
+        this->A = std::move(A);
+        init();
+        return *this;
+    }
+
+    FenwickTreeBlocked &operator = (const FenwickTreeBlocked &) = default;
+    FenwickTreeBlocked &operator = (FenwickTreeBlocked &&) = default;
+
+    operator V () const & {
+        return A;
+    }
+    operator V () && {
+        S.clear();
+        return std::move(A);
+    }
+
+    // Returns the sum of the first i elements (indices 0 to i)
+    T prefix_sum(size_type i) const {
+        const auto b = i/B;
+        T sum = block_prefix(b);
+        for (auto k = b*B; k <= i; ++k)
+            sum += A[k];
+        return sum;
+    }
+
+    // Add delta to element with index i (zero-based)
+    void add(size_type i, T delta) {
+        A[i] += delta;
+        block_add(i/B, delta);
+    }
+
+    // Returns sum of nums[i + 1] to nums[j].
+    T range_sum(size_type i, size_type j) const {
+        T sum = prefix_sum(j);
+        sum -= prefix_sum(i);
+        return sum;
+    }
+
+    T get(size_type i) const {
+        return A[i];
+    }
+
+    void set(size_type i, T v) {
+        v -= A[i];
+        add(i, v);
+    }
+
+    template <class... Args>
+    void emplace_back(Args&&...args) {
+        const auto &back = A.emplace_back(std::forward<Args>(args)...);
+        if (const auto b = (A.size() - 1)/B; b + 1 < S.size()) {
+            block_add(b, back);
+        } else {
+            // new block: the new node covers (b + 1 - LSB(b + 1); b + 1]
+            S.push_back(back);
+            for (auto j = b; j + LSB(j) == b + 1; j -= LSB(j))
+                S.back() += S[j];
+        }
+    }
+    void push_back(T&&x) {
+        return emplace_back(std::move(x));
+    }
+    void push_back(const T& x) {
+        return emplace_back(x);
+    }
+
+    void pop_back() {
+        block_sub((A.size() - 1)/B, A.back());
+        A.pop_back();
+        if (blocks(A.size()) + 1 < S.size())
+            S.pop_back();
+    }
+
+    template <class Iterator>
+    void append(Iterator begin, Iterator end) {
+        for (; begin != end; ++begin)
+            push_back(*begin);
+    }
+
+    void reserve(size_type size) {
+        A.reserve(size);
+        S.reserve(blocks(size) + 1);
+    }
+
+    void resize(size_type size) {
+        resize(size, T());
+    }
+
+    void resize(size_type size, const T& default_value) {
+        while (A.size() > size)
+            pop_back();
+        while (A.size() < size)
+            push_back(default_value);
+    }
+
+    // Same results as FenwickTree::upper_bound / lower_bound. `j` is accepted for
+    // interface compatibility only, the block descent derives its own bound from `i`.
+    // Requires: all values are non-negative
+    size_type upper_bound(T value, size_type i, size_type) const {
+        return upper_bound(value, i);
+    }
+    size_type upper_bound(T value, size_type i) const {
+        return search(i, [&value](const T &s) { return value < s; });
+    }
+    size_type upper_bound(T value) const {
+        return upper_bound(value, size());
+    }
+
+    size_type lower_bound(T value, size_type i, size_type) const {
+        return lower_bound(value, i);
+    }
+    size_type lower_bound(T value, size_type i) const {
+        return search(i, [&value](const T &s) { return !(s < value); });
+    }
+    size_type lower_bound(T value) const {
+        return lower_bound(value, size());
+    }
+
+    constexpr size_type size() const { return A.size(); }
+
+    constexpr bool empty() const { return A.empty(); }
+
+    private:
+    struct FenwickReference {
+        FenwickTreeBlocked &f;
+        size_type index;
+        FenwickReference(FenwickTreeBlocked &f, size_type index) : f(f), index(index) {}
+        FenwickReference(const FenwickReference &) = default;
+        operator T() const {
+            return f.get(index);
+        }
+        FenwickReference &operator =(T v) {
+            f.set(index, v);
+            return *this;
+        }
+        FenwickReference &operator +=(T v) {
+            f.add(index, v);
+            return *this;
+        }
+        FenwickReference &operator -=(T v) {
+            f.add(index, -v);
+            return *this;
+        }
+        FenwickReference &operator = (const FenwickReference &fr) {
+            return *this = T(fr);
+        }
+        bool operator == (const FenwickReference &fr) const {
+            return T(*this) == T(fr);
+        }
+    };
+    public:
+    FenwickReference operator [](size_type index) {
+        return FenwickReference(*this, index);
+    }
+    FenwickReference front() { return (*this)[0]; }
+    FenwickReference back() { return (*this)[size() - 1]; }
+};
+// Fenwick tree with nodes packed by level, after Marchini & Vigna's compact Fenwick
+// trees: with elements in [0; 2^Bits), a node covering LSB(i) = 2^L elements fits in
+// Bits + L bits. Nodes are stored level by level (node i of level L = ctz(i) is the
+// (i >> (L + 1))-th of its level), bit-packed, and read / updated with one unaligned
+// 64-bit load / store, so size is about n*(Bits + 1) bits instead of n*sizeof(T).
+// Requires: every element stays in [0; 2^Bits) (deltas may be negative),
+// Bits + bit_width(size()) <= 57 (the constructor throws std::length_error otherwise).
+// Same index conventions as FenwickTree (prefix_sum(i) includes element i).
+template <unsigned Bits, typename T = std::int64_t>
+class FenwickTreeCompact {
+    static_assert(Bits > 0 && Bits <= 32);
+    public:
+    typedef std::size_t size_type;
+    typedef T value_type;
+    private:
+    size_type n;
+    std::size_t offset[sizeof(size_type)*8 + 1] = {}; // first bit of each level
+    std::vector<std::uint8_t> data; // + 8 bytes so every node can be loaded as a word
+    static size_type level_size(size_type n, unsigned level) {
+        return ((n >> level) + 1) >> 1;
+    }
+    std::size_t bit(size_type i, unsigned level) const {
+        return offset[level] + (i >> (level + 1))*(Bits + level);
+    }
+    std::uint64_t node(size_type i, unsigned level) const {
+        const auto b = bit(i, level);
+        std::uint64_t w;
+        std::memcpy(&w, data.data() + (b >> 3), sizeof(w));
+        return (w >> (b & 7)) & ((std::uint64_t(1) << (Bits + level)) - 1);
+    }
+    // the field stays in range, so adding in place never carries into the neighbours
+    void node_add(size_type i, unsigned level, T delta) {
+        const auto b = bit(i, level);
+        std::uint64_t w;
+        std::memcpy(&w, data.data() + (b >> 3), sizeof(w));
+        w += static_cast<std::uint64_t>(delta) << (b & 7);
+        std::memcpy(data.data() + (b >> 3), &w, sizeof(w));
+    }
+    public:
+    FenwickTreeCompact(size_type size = 0):n(size) {
+        // wider nodes would run past the 64-bit word node() / node_add() access
+        if (Bits + std::bit_width(size) > 57)
+            throw std::length_error("FenwickTreeCompact: Bits + bit_width(size) > 57");
+        for (unsigned l = 0; l < sizeof(size_type)*8; ++l)
+            offset[l + 1] = offset[l] + level_size(n, l)*(Bits + l);
+        data.assign((offset[sizeof(size_type)*8] + 7)/8 + sizeof(std::uint64_t), 0);
+    }
+
+    // O(n), no temporary: node i is nums[i - 1] plus its children i - 2^t, t < ctz(i)
+    template <typename V> requires requires (const V &v) { v.size(); }
+    FenwickTreeCompact(const V &nums):FenwickTreeCompact(nums.size()) {
+        for (size_type i = 1; i <= n; ++i) {
+            const unsigned l = std::countr_zero(i);
+            T v = nums[i - 1];
+            for (unsigned t = 0; t < l; ++t)
+                v += node(i - (size_type(1) << t), t);
+            node_add(i, l, v);
+        }
+    }
+
+    // Returns the sum of the first i elements (indices 0 to i)
+    T prefix_sum(size_type i) const {
+        T sum = 0;
+        for (++i; i != 0; i &= i - 1)
+            sum += node(i, std::countr_zero(i));
+        return sum;
+    }
+
+    // Add delta to element with index i (zero-based)
+    void add(size_type i, T delta) {
+        for (++i; i <= n; i += i & -i)
+            node_add(i, std::countr_zero(i), delta);
+    }
+
+    // Returns sum of nums[i + 1] to nums[j].
+    T range_sum(size_type i, size_type j) const {
+        return prefix_sum(j) - prefix_sum(i);
+    }
+
+    T get(size_type i) const {
+        return i == 0 ? prefix_sum(0) : range_sum(i - 1, i);
+    }
+
+    // Same results as FenwickTree::lower_bound / upper_bound;
+    // the descent step of width 2^L only ever reads level L
+    size_type lower_bound(T value) const {
+        size_type pos = 0;
+        for (unsigned l = n ? std::bit_width(n) : 0; l-- > 0;)
+            if (auto p = pos + (size_type(1) << l); p <= n)
+                if (T v = node(p, l); v < value) {
+                    value -= v;
+                    pos = p;
+                }
+        return pos;
+    }
+
+    size_type upper_bound(T value) const {
+        size_type pos = 0;
+        for (unsigned l = n ? std::bit_width(n) : 0; l-- > 0;)
+            if (auto p = pos + (size_type(1) << l); p <= n)
+                if (T v = node(p, l); !(value < v)) {
+                    value -= v;
+                    pos = p;
+                }
+        return pos;
+    }
+
+    constexpr size_type size() const { return n; }
+
+    constexpr bool empty() const { return n == 0; }
+
+    // heap bytes used by the nodes
+    std::size_t bytes() const { return data.size(); }
+};
+// K Fenwick trees over the same indices with the K lanes of a node stored contiguously
+// (A[i*K + k]), so add()/prefix_sum() on all lanes walk the LSB path once and the
+// per-node lane loop vectorizes. Same one-based layout with the A[0] twist as FenwickTree.
+template <typename T, std::size_t K, typename V = std::vector<T>>
+class FenwickTreeMulti {
+    V A;
+    public:
+    typedef typename V::size_type size_type;
+    typedef std::array<T, K> value_type;
+    static constexpr std::size_t lanes = K;
+    private:
+    static const size_type LSB(const size_type i) {
+        return i & -i;
+    }
+    static void add_lanes(T *a, const T *b) {
+        for (std::size_t k = 0; k < K; ++k)
+            a[k] += b[k];
+    }
+    static void sub_lanes(T *a, const T *b) {
+        for (std::size_t k = 0; k < K; ++k)
+            a[k] -= b[k];
+    }
+    void init() {
+        const auto n = size();
+        for (size_type i = 1; i < n; ++i) {
+            auto j = i + LSB(i);
+            if (j < n)
+                add_lanes(&A[j*K], &A[i*K]);
+        }
+    }
+    static void fini(V &A) {
+        const size_type n = A.size()/K;
+        for (size_type i = n; i-- > 1;) {
+            auto j = i + LSB(i);
+            if (j < n)
+                sub_lanes(&A[j*K], &A[i*K]);
+        }
+    }
+    public:
+    FenwickTreeMulti(size_type size = 0):A(size*K) {
+    }
+
+    // nums holds size()*K values, element-major: nums[i*K + k] is lane k of element i
+    FenwickTreeMulti(const V &nums):A(nums) {
+        init();
+    }
+
+    FenwickTreeMulti(V &&nums):A(std::move(nums)) {
+        init();
+    }
+
+    FenwickTreeMulti(const FenwickTreeMulti &) = default;
+    FenwickTreeMulti(FenwickTreeMulti &&) = default;
+    FenwickTreeMulti &operator = (const FenwickTreeMulti &) = default;
+    FenwickTreeMulti &operator = (FenwickTreeMulti &&) = default;
+
+    operator V () const & {
+        V ret = A;
+        fini(ret);
+        return ret;
+    }
+    operator V () && {
+        fini(A);
+        return std::move(A);
+    }
+
+    // Returns the sums of the first i elements (indices 0 to i) on every lane
+    value_type prefix_sum(size_type i) const {
+        value_type sum;
+        std::copy_n(&A[0], K, sum.begin());
+        for (; i != 0; i -= LSB(i))
+            add_lanes(sum.data(), &A[i*K]);
+        return sum;
+    }
+
+    T prefix_sum(size_type i, std::size_t lane) const {
+        T sum = A[lane];
+        for (; i != 0; i -= LSB(i))
+            sum += A[i*K + lane];
+        return sum;
+    }
+
+    // Add delta[k] to lane k of element with index i (zero-based)
+    void add(size_type i, const value_type &delta) {
+        if (i == 0) {
+            add_lanes(&A[0], delta.data());
+            return;
+        }
+        for (const auto n = size(); i < n; i += LSB(i))
+            add_lanes(&A[i*K], delta.data());
+    }
+
+    void add(size_type i, std::size_t lane, T delta) {
+        if (i == 0) {
+            A[lane] += delta;
+            return;
+        }
+        for (const auto n = size(); i < n; i += LSB(i))
+            A[i*K + lane] += delta;
+    }
+
+    // Returns sums of nums[i + 1] to nums[j] on every lane
+    value_type range_sum(size_type i, size_type j) const {
+        value_type sum{};
+        for (; j > i; j -= LSB(j))
+            add_lanes(sum.data(), &A[j*K]);
+        for (; i > j; i -= LSB(i))
+            sub_lanes(sum.data(), &A[i*K]);
+        return sum;
+    }
+
+    value_type get(size_type i) const {
+        if (i)
+            return range_sum(i - 1, i);
+        value_type res;
+        std::copy_n(&A[0], K, res.begin());
+        return res;
+    }
+
+    void set(size_type i, value_type v) {
+        sub_lanes(v.data(), get(i).data());
+        add(i, v);
+    }
+
+    void push_back(const value_type &x) {
+        const auto cidx = size();
+        A.insert(A.end(), x.begin(), x.end());
+        if (!cidx)
+            return;
+        for (auto j = cidx - 1; j + LSB(j) == cidx; j -= LSB(j))
+            add_lanes(&A[cidx*K], &A[j*K]);
+    }
+
+    void pop_back() {
+        A.resize(A.size() - K);
+    }
+
+    void reserve(size_type size) {
+        A.reserve(size*K);
+    }
+
+    // Same as FenwickTree::upper_bound / lower_bound, on lane `lane` only
+    size_type upper_bound(T value, std::size_t lane, size_type i, size_type j) const {
+        auto s = A[lane];
+        if (value < s)
+            return 0;
+        size_type res = 0;
+        for (; j > 0; j >>= 1)
+            if (auto p = res + j; p < i)
+                if (auto t = s; !(value < (t += A[p*K + lane]))) {
+                    s = t;
+                    res = p;
+                }
+        return res + 1;
+    }
+    size_type upper_bound(T value, std::size_t lane, size_type i) const {
+        size_type j = i;
+        while(auto npow = j - LSB(j))
+            j = npow;
+        return upper_bound(value, lane, i, j);
+    }
+    size_type upper_bound(T value, std::size_t lane) const {
+        return upper_bound(value, lane, size());
+    }
+
+    size_type lower_bound(T value, std::size_t lane, size_type i, size_type j) const {
+        auto s = A[lane];
+        if (!(s < value))
+            return 0;
+        size_type res = 0;
+        for (; j > 0; j >>= 1)
+            if (auto p = res + j; p < i)
+                if (auto t = s; (t += A[p*K + lane]) < value) {
+                    s = t;
+                    res = p;
+                }
+        return res + 1;
+    }
+    size_type lower_bound(T value, std::size_t lane, size_type i) const {
+        size_type j = i;
+        while(auto npow = j - LSB(j))
+            j = npow;
+        return lower_bound(value, lane, i, j);
+    }
+    size_type lower_bound(T value, std::size_t lane) const {
+        return lower_bound(value, lane, size());
+    }
+
+    constexpr size_type size() const { return A.size()/K; }
+
+    constexpr bool empty() const { return A.empty(); }
+};
 namespace V1 {
     template <typename T, typename V = std::vector<T>>
     class FenwickTreeRangeUpdateRangeQuery {
@@ -291,56 +1114,105 @@ namespace V1 {
 	    const auto n = size();
 	    t1.add(l, val);
 	    t2.add(l, val*static_cast<value_type>(l) - val);
-	    if (r + 1 != size) {
+	    if (r + 1 < n) {
 		t1.add(r + 1, -val);
 		t2.add(r + 1, -val*static_cast<value_type>(r));
 	    }
 	}
-	// return 
-	value_type prefix_sum(size_t i) {
+	// Returns the sum of nums[0] to nums[i]
+	value_type prefix_sum(size_t i) const {
 	    return t1.prefix_sum(i)*static_cast<value_type>(i) - t2.prefix_sum(i);
 	}
 	// Returns sum of nums[i + 1] to nums[j].
 	// Same as prefix_sum(j) - prefix_sum(i), but a bit faster
-	value_type range_sum(size_t l, size_t r) {
-	    return t1.sum(r)*static_cast<value_type>(r) - t1.prefix_sum(l)*static_cast<value_type>(l) - t2.range_sum(l, r);
+	value_type range_sum(size_t l, size_t r) const {
+	    return t1.prefix_sum(r)*static_cast<value_type>(r) - t1.prefix_sum(l)*static_cast<value_type>(l) - t2.range_sum(l, r);
 	}
     };
 } // V1
 namespace V2 {
     template <typename T>
     class FenwickTreeRangeUpdateRangeQuery {
+	// V1's two trees interleaved into one FenwickTree of pairs, so an update or a query
+	// walks one path and touches one cache line per node.
+	// The tree holds the difference array d[j] = nums[j] - nums[j - 1] as pairs {d[j], d[j]*j};
+	// with {s1, s2} the sums of pairs 0..i, prefix_sum(i) = s1*(i + 1) - s2.
 	// T is expected to support 'a += b', 'a -= b', 'a + b', 'a - b', 'a * b', '-a', a cast from size_type
 	struct vpair {
 	    T v1;
 	    T v2;
-	    void operator += (const T& other) { v1 += other.v1; v2 += other.v2; }
-	    void operator -= (const T& other) { v1 -= other.v1; v2 -= other.v2; }
+	    vpair &operator += (const vpair &other) { v1 += other.v1; v2 += other.v2; return *this; }
+	    vpair &operator -= (const vpair &other) { v1 -= other.v1; v2 -= other.v2; return *this; }
 	};
-	FenwickTree<vpair>> t;
+	FenwickTree<vpair> t;
 	public:
-	typedef decltype(t)::size_type size_type;
+	typedef typename FenwickTree<vpair>::size_type size_type;
 	typedef T value_type;
-	FenwickTreeRangeUpdateRangeQuery(size_type size):t(size) {}
+	private:
+	static value_type at(const vpair &s, size_type i) {
+	    return s.v1*static_cast<value_type>(i + 1) - s.v2;
+	}
+	static std::vector<vpair> diff(const std::vector<value_type> &nums) {
+	    std::vector<vpair> res(nums.size());
+	    for (size_type j = 0; j < nums.size(); ++j) {
+		auto d = j ? nums[j] - nums[j - 1] : nums[0];
+		res[j] = vpair{d, d*static_cast<value_type>(j)};
+	    }
+	    return res;
+	}
+	public:
+	FenwickTreeRangeUpdateRangeQuery(size_type size = 0):t(size) {}
+	// O(n)
+	FenwickTreeRangeUpdateRangeQuery(const std::vector<value_type> &nums):t(diff(nums)) {}
 	FenwickTreeRangeUpdateRangeQuery(const FenwickTreeRangeUpdateRangeQuery &) = default;
 	FenwickTreeRangeUpdateRangeQuery(FenwickTreeRangeUpdateRangeQuery &&) = default;
+	FenwickTreeRangeUpdateRangeQuery &operator = (const FenwickTreeRangeUpdateRangeQuery &) = default;
+	FenwickTreeRangeUpdateRangeQuery &operator = (FenwickTreeRangeUpdateRangeQuery &&) = default;
 	auto size() const { return t.size(); }
+	bool empty() const { return t.empty(); }
 	// adds val to nums[l] ... nums[r]
-	void add_range(size_type l, size_t r, const value_type&val) {
-	    const auto n = size();
-	    t.add(l, vpair{val, val*static_cast<value_type>(l) - val});
-	    if (r + 1 != size)
-		t.add(r + 1, vpair {-val, -val*static_cast<value_type>(r)});
+	void add_range(size_type l, size_type r, const value_type &val) {
+	    t.add(l, vpair{val, val*static_cast<value_type>(l)});
+	    if (r + 1 < size())
+		t.add(r + 1, vpair{-val, -val*static_cast<value_type>(r + 1)});
 	}
-	value_type prefix_sum(size_t i) {
-	    auto vp = t.prefix_sum(i);
-	    return vp.v1*static_cast<value_type>(i) - vp.v2;
+	void add(size_type i, const value_type &val) {
+	    add_range(i, i, val);
 	}
-	value_type range_sum(size l, size_r) {
+	// Returns the sum of nums[0] to nums[i]
+	value_type prefix_sum(size_type i) const {
+	    return at(t.prefix_sum(i), i);
+	}
+	// Returns sum of nums[l + 1] to nums[r]
+	value_type range_sum(size_type l, size_type r) const {
 	    return prefix_sum(r) - prefix_sum(l);
 	}
+	value_type get(size_type i) const {
+	    return i ? range_sum(i - 1, i) : prefix_sum(0);
+	}
 	void push_back(const value_type &val) {
-	    t.push_back(vpair {val, val*static_cast<value_type>(size()) - val });
+	    const auto n = size();
+	    auto d = val;
+	    if (n)
+		d -= get(n - 1);
+	    t.push_back(vpair{d, d*static_cast<value_type>(n)});
+	}
+	void pop_back() {
+	    t.pop_back();
+	}
+	void reserve(size_type size) {
+	    t.reserve(size);
+	}
+	// Find the minimum idx with prefix_sum(idx) >= value (size() if none)
+	// Requires: all values are non-negative
+	// O(log n)
+	size_type lower_bound(const value_type &value) const {
+	    return t.search([&value](const vpair &s, size_type i) { return !(at(s, i) < value); });
+	}
+	// Find the minimum idx with prefix_sum(idx) > value (size() if none)
+	size_type upper_bound(const value_type &value) const {
+	    return t.search([&value](const vpair &s, size_type i) { return value < at(s, i); });
+	}
     };
 } // V2
 #endif
@@ -0,0 +1,78 @@
+#include <bits/stdc++.h>
+#include <ext/pb_ds/assoc_container.hpp>
+#include "bench.hpp"
+#include "indexed-multiset.hpp"
+using namespace std;
+using namespace __gnu_pbds;
+// see bench.hpp for build/run instructions
+// pbds has no multiset: duplicates are told apart by an insertion counter
+typedef tree<pair<uint64_t, uint32_t>, null_type, less<>, rb_tree_tag, tree_order_statistics_node_update> pbds_multiset;
+template <typename Set, typename Insert, typename Erase, typename Rank, typename Select>
+void bench_set(const string &prefix, size_t n, size_t bytes, Set &s, const vector<uint64_t> &ins, const vector<uint64_t> &qry, const vector<size_t> &ord,
+        Insert insert, Erase erase, Rank rank, Select select) {
+    // bytes: heap already held by s, insertion growth is added to it
+    const auto before = Bench::live_bytes();
+    Bench::run((prefix + "/insert").c_str(), n, ins.size(), bytes, [&]() {
+        for (uint32_t i = 0; i < ins.size(); ++i)
+            insert(s, ins[i], i);
+    });
+    bytes += Bench::live_bytes() - before;
+    Bench::run((prefix + "/order_of_key").c_str(), n, qry.size(), bytes, [&]() {
+        size_t acc = 0;
+        for (auto x: qry)
+            acc += rank(s, x);
+        Bench::keep(acc);
+    });
+    Bench::run((prefix + "/find_by_order").c_str(), n, ord.size(), bytes, [&]() {
+        uint64_t acc = 0;
+        for (auto k: ord)
+            acc += select(s, k);
+        Bench::keep(acc);
+    });
+    Bench::run((prefix + "/erase").c_str(), n, ins.size(), bytes, [&]() {
+        for (uint32_t i = 0; i < ins.size(); ++i)
+            erase(s, ins[i], i);
+    });
+}
+int main(int argc, char *argv[]) {
+    Bench::header();
+    for (auto n: Bench::sizes(argc, argv)) {
+        const auto m = Bench::ops(n);
+        auto g = Bench::rng();
+        // n insertions over ~n/2 distinct keys
+        vector<uint64_t> universe(max<size_t>(1, n/2));
+        for (auto &x: universe)
+            x = g();
+        vector<uint64_t> ins(n), qry(m);
+        for (auto &x: ins)
+            x = universe[g() % universe.size()];
+        for (auto &x: qry)
+            x = g();
+        vector<size_t> ord(m);
+        for (auto &k: ord)
+            k = g() % n;
+        auto ins_im = [](auto &s, uint64_t x, uint32_t) { s.insert(x); };
+        auto erase_im = [](auto &s, uint64_t x, uint32_t) { s.erase_one(x); };
+        auto rank_im = [](auto &s, uint64_t x) { return s.order_of_key(x); };
+        auto select_im = [](auto &s, size_t k) { return s.find_by_order(k); };
+        {
+            auto bytes = Bench::live_bytes();
+            auto s = Bench::build("indexed-multiset/build_universe", n, [&]() { return indexed_multiset<uint64_t>(universe); });
+            bytes = Bench::live_bytes() - bytes;
+            bench_set("indexed-multiset", n, bytes, s, ins, qry, ord, ins_im, erase_im, rank_im, select_im);
+        }
+        {
+            indexed_multiset<uint64_t> s;
+            bench_set("indexed-multiset-online", n, 0, s, ins, qry, ord, ins_im, erase_im, rank_im, select_im);
+        }
+        {
+            pbds_multiset s;
+            bench_set("pbds-tree", n, 0, s, ins, qry, ord,
+                [](auto &s, uint64_t x, uint32_t i) { s.insert({x, i}); },
+                [](auto &s, uint64_t x, uint32_t i) { s.erase({x, i}); },
+                [](auto &s, uint64_t x) { return s.order_of_key({x, 0}); },
+                [](auto &s, size_t k) { return s.find_by_order(k)->first; });
+        }
+    }
+}
+// vim: sw=4 et
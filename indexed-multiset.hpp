@@ -0,0 +1,170 @@
+#ifndef INDEXED_MULTISET_HPP
+#define INDEXED_MULTISET_HPP
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "fenwick-tree.hpp"
+// Order-statistics multiset (rank / select) over a flat FenwickTree of counts
+// indexed by compressed keys; a drop-in for pbds' tree_order_statistics_node_update
+// without the pointer chasing.
+// Keys are compressed offline (constructor taking the universe of keys) and/or
+// incrementally: keys outside the universe go to a small sorted `pending` multiset,
+// merged into the universe (O(U) rebuild) when it outgrows 4 sqrt(U).
+// time: O(log U), plus O(log P) (O(log U * log P) in-cache for find_by_order)
+// while P keys are pending.
+template <typename Key, typename Compare = std::less<Key>>
+class indexed_multiset {
+    public:
+    typedef std::size_t size_type;
+    typedef Key key_type;
+    typedef Key value_type;
+    private:
+    std::vector<Key> keys;           // universe, sorted, unique
+    FenwickTree<size_type> cnt;      // occurrences of keys[i]
+    std::vector<Key> pending;        // sorted, keys not in the universe
+    size_type n = 0;
+    [[no_unique_address]]
+    Compare comp;
+
+    // index of key in the universe, keys.size() if absent
+    size_type find_key(const Key &key) const {
+        auto it = std::lower_bound(keys.begin(), keys.end(), key, comp);
+        return it != keys.end() && !comp(key, *it) ? it - keys.begin() : keys.size();
+    }
+    // number of universe elements < key
+    size_type universe_less(const Key &key) const {
+        const size_type i = std::lower_bound(keys.begin(), keys.end(), key, comp) - keys.begin();
+        return i ? cnt.prefix_sum(i - 1) : 0;
+    }
+    // s-th smallest universe element (0-based)
+    const Key &universe_select(size_type s) const {
+        return keys[cnt.upper_bound(s)];
+    }
+    void merge_pending() {
+        std::vector<size_type> c(std::move(cnt));
+        std::vector<Key> nkeys;
+        std::vector<size_type> nc;
+        nkeys.reserve(keys.size() + pending.size());
+        nc.reserve(keys.size() + pending.size());
+        size_type i = 0;
+        for (auto p = pending.begin(); i < keys.size() || p != pending.end();) {
+            if (p == pending.end() || (i < keys.size() && comp(keys[i], *p))) {
+                nkeys.push_back(std::move(keys[i]));
+                nc.push_back(c[i++]);
+            } else {
+                nkeys.push_back(*p);
+                nc.push_back(0);
+                for (; p != pending.end() && !comp(nkeys.back(), *p); ++p)
+                    ++nc.back();
+            }
+        }
+        keys = std::move(nkeys);
+        cnt = std::move(nc);
+        pending.clear();
+    }
+    public:
+    indexed_multiset(Compare comp = Compare()) : comp(comp) {
+    }
+
+    // offline compression: keys that may be inserted (duplicates allowed)
+    template <typename Iterator>
+    indexed_multiset(Iterator begin, Iterator end, Compare comp = Compare()) : keys(begin, end), comp(comp) {
+        std::sort(keys.begin(), keys.end(), comp);
+        keys.erase(std::unique(keys.begin(), keys.end(), [this](const Key &a, const Key &b) { return !this->comp(a, b); }), keys.end());
+        cnt = FenwickTree<size_type>(keys.size());
+    }
+
+    explicit indexed_multiset(const std::vector<Key> &universe, Compare comp = Compare()) : indexed_multiset(universe.begin(), universe.end(), comp) {
+    }
+
+    size_type size() const { return n; }
+
+    bool empty() const { return n == 0; }
+
+    void clear() {
+        cnt = FenwickTree<size_type>(keys.size());
+        pending.clear();
+        n = 0;
+    }
+
+    void insert(const Key &key) {
+        ++n;
+        if (auto i = find_key(key); i < keys.size()) {
+            cnt.add(i, 1);
+            return;
+        }
+        pending.insert(std::upper_bound(pending.begin(), pending.end(), key, comp), key);
+        if (pending.size() > std::max<size_type>(64, 4*std::sqrt(double(keys.size()))))
+            merge_pending();
+    }
+
+    // removes one occurrence of key, returns false if there is none
+    bool erase_one(const Key &key) {
+        if (auto i = find_key(key); i < keys.size()) {
+            if (!cnt.get(i))
+                return false;
+            cnt.add(i, -1);
+        } else {
+            auto it = std::lower_bound(pending.begin(), pending.end(), key, comp);
+            if (it == pending.end() || comp(key, *it))
+                return false;
+            pending.erase(it);
+        }
+        --n;
+        return true;
+    }
+
+    // removes all occurrences of key, returns their number
+    size_type erase(const Key &key) {
+        size_type res = 0;
+        if (auto i = find_key(key); i < keys.size()) {
+            res = cnt.get(i);
+            cnt.add(i, -res);
+        } else {
+            auto [lo, hi] = std::equal_range(pending.begin(), pending.end(), key, comp);
+            res = hi - lo;
+            pending.erase(lo, hi);
+        }
+        n -= res;
+        return res;
+    }
+
+    size_type count(const Key &key) const {
+        if (auto i = find_key(key); i < keys.size())
+            return cnt.get(i);
+        auto [lo, hi] = std::equal_range(pending.begin(), pending.end(), key, comp);
+        return hi - lo;
+    }
+
+    bool contains(const Key &key) const {
+        return count(key) != 0;
+    }
+
+    // number of elements less than key
+    size_type order_of_key(const Key &key) const {
+        return universe_less(key) + (std::lower_bound(pending.begin(), pending.end(), key, comp) - pending.begin());
+    }
+
+    // k-th smallest element (0-based), requires k < size()
+    const Key &find_by_order(size_type k) const {
+        if (pending.empty())
+            return universe_select(k);
+        // one descent over the universe, counting the pending keys below each
+        // probe (pending is small and stays in cache): p = first universe key with
+        // more than k elements up to it, below = universe elements before it
+        size_type below = 0;
+        const auto p = cnt.search([&](size_type s, size_type i) {
+            if (s + (std::upper_bound(pending.begin(), pending.end(), keys[i], comp) - pending.begin()) > k)
+                return true;
+            below = s;
+            return false;
+        });
+        const auto j = k - below;
+        if (p < keys.size() && (j >= pending.size() || !comp(pending[j], keys[p])))
+            return keys[p];
+        return pending[j];
+    }
+};
+#endif // INDEXED_MULTISET_HPP
+// vim: sw=4 et
@@ -0,0 +1,279 @@
+#ifndef MMAP_VECTOR_HPP
+#define MMAP_VECTOR_HPP
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+// vector-like container of trivially copyable T in a memory-mapped file (POSIX),
+// usable as storage V of FenwickTree & co:
+//   auto v = mmap_vector<int64_t>::create("counters.bin", n);   // zero-filled
+//   auto v = mmap_vector<int64_t>::open("counters.bin");        // reopen in O(1)
+//   auto v = mmap_vector<int64_t>::open("counters.bin", false); // read-only, MAP_SHARED
+// File layout: a 64-byte header (magic, version, element size/kind, size) followed
+// by the elements; capacity is whatever fits in the file. The mapping is shared, so
+// changes reach the file (and every other process mapping it) without sync(); sync()
+// only waits for them to hit the disk. Writing through a read-only vector faults.
+// A vector sees at most the elements its own mapping covers: when a writer grows the
+// file past that, a reader's size() stops at its capacity() until it is reopened.
+// Scattered writes over more data than the kernel lets stay dirty (vm.dirty_ratio)
+// are throttled to writeback speed: fine for warm-start counters, not for a hot
+// write path over a file much larger than that.
+// Default-constructed and copied vectors are anonymous (not backed by a file); a
+// moved-from vector is empty, anonymous and writable, and maps nothing until it grows.
+// Copy assignment writes into the existing storage, so a file-backed vector stays
+// file-backed; move assignment takes over the other vector's storage, file or not.
+template <typename T>
+class mmap_vector {
+    static_assert(std::is_trivially_copyable_v<T>);
+    public:
+    typedef std::size_t size_type;
+    typedef T value_type;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+    static constexpr std::uint32_t version = 1;
+    private:
+    struct header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t elem_size;
+        std::uint32_t elem_kind;
+        std::uint32_t elem_align;
+        std::uint64_t size;
+    };
+    static constexpr char magic[8] = "MMAPVEC";
+    static constexpr size_type offset = std::max<size_type>(64, alignof(T));
+    static_assert(sizeof(header) <= offset);
+    static constexpr std::uint32_t kind() {
+        return std::is_floating_point_v<T> ? 'f' : std::is_integral_v<T> ? (std::is_signed_v<T> ? 'i' : 'u') : 'o';
+    }
+
+    int fd = -1;
+    bool writable = true;
+    char *map = nullptr;
+    size_type bytes = 0;
+
+    header *hdr() const { return reinterpret_cast<header *>(map); }
+    T *A() const { return reinterpret_cast<T *>(map + offset); }
+
+    [[noreturn]] static void fail(const char *what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+    static size_type page_round(size_type b) {
+        const size_type page = sysconf(_SC_PAGESIZE);
+        return (b + page - 1)/page*page;
+    }
+    char *map_shared(size_type b) const {
+        auto p = mmap(nullptr, b, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            fail("mmap_vector: mmap");
+        return static_cast<char *>(p);
+    }
+    void map_file(size_type b) {
+        map = map_shared(b);
+        bytes = b;
+    }
+    void map_anonymous(size_type b) {
+        auto p = mmap(nullptr, b, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            fail("mmap_vector: mmap");
+        map = static_cast<char *>(p);
+        bytes = b;
+        std::memcpy(hdr()->magic, magic, sizeof magic);
+        hdr()->version = version;
+        hdr()->elem_size = sizeof(T);
+        hdr()->elem_kind = kind();
+        hdr()->elem_align = alignof(T);
+        hdr()->size = 0;
+    }
+    void release() {
+        if (map)
+            munmap(map, bytes);
+        if (fd >= 0)
+            close(fd);
+        map = nullptr;
+        fd = -1;
+    }
+    // grow the mapping (and the file) to hold at least n elements; the new mapping is
+    // made before the old one goes, so a failure leaves the vector as it was
+    void grow(size_type n) {
+        if (!writable)
+            throw std::logic_error("mmap_vector: read-only");
+        const auto b = page_round(offset + std::max(n, 2*capacity())*sizeof(T));
+        if (fd >= 0) {
+            if (ftruncate(fd, b) != 0)
+                fail("mmap_vector: ftruncate");
+            auto p = map_shared(b);
+            munmap(map, bytes);
+            map = p;
+            bytes = b;
+        } else {
+            auto old = map;
+            auto ob = bytes;
+            map_anonymous(b);
+            if (old) {
+                std::memcpy(map, old, ob);
+                munmap(old, ob);
+            }
+        }
+    }
+    struct from_fd {};
+    mmap_vector(from_fd, int fd, bool writable) : fd(fd), writable(writable) {}
+    public:
+    mmap_vector(size_type n = 0) {
+        map_anonymous(page_round(offset + n*sizeof(T)));
+        hdr()->size = n;
+    }
+
+    mmap_vector(size_type n, const T &v) : mmap_vector(n) {
+        std::fill_n(A(), n, v);
+    }
+
+    mmap_vector(const mmap_vector &other) : mmap_vector(other.size()) {
+        std::copy_n(other.data(), other.size(), A());
+    }
+
+    mmap_vector(mmap_vector &&other) noexcept
+        : fd(std::exchange(other.fd, -1)), writable(std::exchange(other.writable, true)),
+          map(std::exchange(other.map, nullptr)), bytes(std::exchange(other.bytes, 0)) {
+    }
+
+    mmap_vector &operator = (const mmap_vector &other) {
+        if (this != &other) {
+            if (!writable)
+                throw std::logic_error("mmap_vector: read-only");
+            const auto n = other.size();
+            reserve(n);
+            std::copy_n(other.data(), n, A());
+            hdr()->size = n;
+        }
+        return *this;
+    }
+
+    mmap_vector &operator = (mmap_vector &&other) noexcept {
+        std::swap(fd, other.fd);
+        std::swap(writable, other.writable);
+        std::swap(map, other.map);
+        std::swap(bytes, other.bytes);
+        return *this;
+    }
+
+    ~mmap_vector() {
+        release();
+    }
+
+    // create (or truncate) `path` holding n zero elements
+    static mmap_vector create(const std::string &path, size_type n = 0) {
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            fail("mmap_vector: open");
+        mmap_vector res(from_fd(), fd, true);
+        const auto b = page_round(offset + n*sizeof(T));
+        if (ftruncate(fd, b) != 0)
+            fail("mmap_vector: ftruncate");
+        res.map_file(b);
+        std::memcpy(res.hdr()->magic, magic, sizeof magic);
+        res.hdr()->version = version;
+        res.hdr()->elem_size = sizeof(T);
+        res.hdr()->elem_kind = kind();
+        res.hdr()->elem_align = alignof(T);
+        res.hdr()->size = n;
+        return res;
+    }
+
+    // map an existing file created by create(); throws std::runtime_error if the
+    // header does not match T or this version
+    static mmap_vector open(const std::string &path, bool writable = true) {
+        const int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd < 0)
+            fail("mmap_vector: open");
+        mmap_vector res(from_fd(), fd, writable);
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            fail("mmap_vector: fstat");
+        if (size_type(st.st_size) < offset)
+            throw std::runtime_error("mmap_vector: " + path + ": truncated header");
+        res.map_file(st.st_size);
+        const auto h = res.hdr();
+        if (std::memcmp(h->magic, magic, sizeof magic) != 0 || h->version != version)
+            throw std::runtime_error("mmap_vector: " + path + ": bad magic or version");
+        if (h->elem_size != sizeof(T) || h->elem_kind != kind() || h->elem_align != alignof(T))
+            throw std::runtime_error("mmap_vector: " + path + ": element type mismatch");
+        if (h->size > res.capacity())
+            throw std::runtime_error("mmap_vector: " + path + ": truncated data");
+        return res;
+    }
+
+    // wait until the elements are written to the disk
+    void sync() const {
+        if (fd >= 0 && msync(map, bytes, MS_SYNC) != 0)
+            fail("mmap_vector: msync");
+    }
+
+    bool read_only() const { return !writable; }
+
+    size_type size() const { return map ? std::min<size_type>(hdr()->size, capacity()) : 0; }
+
+    bool empty() const { return size() == 0; }
+
+    size_type capacity() const { return map ? (bytes - offset)/sizeof(T) : 0; }
+
+    T *data() { return map ? A() : nullptr; }
+    const T *data() const { return map ? A() : nullptr; }
+
+    T &operator [](size_type i) { return A()[i]; }
+    const T &operator [](size_type i) const { return A()[i]; }
+
+    T &back() { return A()[size() - 1]; }
+    const T &back() const { return A()[size() - 1]; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + size(); }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + size(); }
+
+    void reserve(size_type n) {
+        if (n > capacity() || !map)
+            grow(n);
+    }
+
+    // v by value: it may be an element of this vector, and reserve() may remap
+    void resize(size_type n, T v = T()) {
+        reserve(n);
+        if (n > size())
+            std::fill(A() + size(), A() + n, v);
+        hdr()->size = n;
+    }
+
+    template <class... Args>
+    T &emplace_back(Args&&...args) {
+        T tmp(std::forward<Args>(args)...); // before reserve(): args may point into this vector
+        reserve(size() + 1);
+        auto &res = A()[size()] = std::move(tmp);
+        ++hdr()->size;
+        return res;
+    }
+    void push_back(const T &x) {
+        emplace_back(x);
+    }
+
+    void pop_back() {
+        --hdr()->size;
+    }
+
+    void clear() {
+        if (map)
+            hdr()->size = 0;
+    }
+};
+#endif // MMAP_VECTOR_HPP
+// vim: sw=4 et
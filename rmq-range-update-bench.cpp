@@ -0,0 +1,46 @@
+#include <bits/stdc++.h>
+#include "bench.hpp"
+using namespace std;
+#include "rmq-range-update.cpp"
+// see bench.hpp for build/run instructions
+int main(int argc, char *argv[]) {
+    Bench::header();
+    for (auto n: Bench::sizes(argc, argv)) {
+        const auto m = Bench::ops(n);
+        vector<int64_t> src(n);
+        auto g = Bench::rng();
+        for (auto &x: src)
+            x = g() % 1000;
+        vector<size_t> pos(m);
+        vector<int64_t> val(m);
+        for (size_t i = 0; i < m; ++i) {
+            pos[i] = g() % n;
+            val[i] = g() % 1000;
+        }
+        auto q = Bench::ranges(n, m, 2);
+        auto bytes = Bench::live_bytes();
+        auto t = Bench::build("rmq/build", n, [&]() {
+            rmq<int64_t, size_t> t(n);
+            for (size_t i = 0; i < n; ++i)
+                t.update(i, src[i]);
+            return t;
+        });
+        bytes = Bench::live_bytes() - bytes;
+        Bench::run("rmq/update(point)", n, m, bytes, [&]() {
+            for (size_t i = 0; i < m; ++i)
+                t.update(pos[i], val[i]);
+        });
+        Bench::run("rmq/update(range)", n, m, bytes, [&]() {
+            for (size_t i = 0; i < m; ++i)
+                t.update(q[i].first, q[i].second - 1, val[i]);
+        });
+        Bench::run("rmq/query", n, m, bytes, [&]() {
+            int64_t acc = 0;
+            for (auto [l, r]: q)
+                acc += t.query(l, r - 1);
+            Bench::keep(acc);
+        });
+    }
+    return 0;
+}
+// vim: sw=4 et
@@ -0,0 +1,307 @@
+#include <bits/stdc++.h>
+#include "bench.hpp"
+#include "segment-tree-nrec.hpp"
+using namespace std;
+// see bench.hpp for build/run instructions
+template <typename Tree>
+void bench_point_update_range_query(const char *prefix, const vector<int64_t> &src, size_t m, int64_t neutral) {
+    const auto n = src.size();
+    auto g = Bench::rng(1);
+    vector<size_t> pos(m);
+    vector<int64_t> val(m);
+    for (size_t i = 0; i < m; ++i) {
+        pos[i] = g() % n;
+        val[i] = g() % 1000;
+    }
+    auto q = Bench::ranges(n, m, 2);
+    auto name = [prefix](const char *op) { return string(prefix) + "/" + op; };
+    auto bytes = Bench::live_bytes();
+    auto st = Bench::build(name("build").c_str(), n, [&]() { return Tree(src.cbegin(), src.cend()); });
+    bytes = Bench::live_bytes() - bytes;
+    if constexpr (requires { Tree(src, 0u); })
+        Bench::build(name("build(parallel)").c_str(), n, [&]() { return Tree(src, 0u); });
+    Bench::run(name("update").c_str(), n, m, bytes, [&]() {
+        for (size_t i = 0; i < m; ++i)
+            st.update(pos[i], val[i]);
+    });
+    Bench::run(name("query_halfopen").c_str(), n, m, bytes, [&]() {
+        int64_t acc = 0;
+        for (auto [l, r]: q)
+            acc += st.query_halfopen(l, r, neutral);
+        Bench::keep(acc);
+    });
+    if constexpr (requires { st.query_batch(q, span<int64_t>()); }) {
+        vector<int64_t> out(m);
+        Bench::run(name("query_batch").c_str(), n, m, bytes, [&]() {
+            st.query_batch(q, out);
+            Bench::keep(out.data());
+        });
+    }
+}
+// search: first index with prefix sum >= random threshold
+template <typename Tree>
+void bench_search(const char *prefix, const vector<int64_t> &src, size_t m) {
+    const auto n = src.size();
+    auto g = Bench::rng(4);
+    auto bytes = Bench::live_bytes();
+    Tree st(src.cbegin(), src.cend());
+    bytes = Bench::live_bytes() - bytes;
+    const auto total = st.query_halfopen(0, n, 0);
+    vector<int64_t> thr(m);
+    for (auto &x: thr)
+        x = g() % (total + 1);
+    Bench::run((string(prefix) + "/search_index_halfopen").c_str(), n, m, bytes, [&]() {
+        size_t acc = 0;
+        for (auto x: thr)
+            acc += st.search_index_halfopen(0, n, 0, [x](auto s) { return s >= x; });
+        Bench::keep(acc);
+    });
+    if constexpr (requires { st.search_index_batch(span<const int64_t>(thr), span<size_t>(), 0, [](auto s, auto x) { return s >= x; }); }) {
+        vector<size_t> out(m);
+        Bench::run((string(prefix) + "/search_index_batch").c_str(), n, m, bytes, [&]() {
+            st.search_index_batch(span<const int64_t>(thr), span<size_t>(out), 0, [](auto s, auto x) { return s >= x; });
+            Bench::keep(out.data());
+        });
+    }
+}
+// readers query_halfopen on a snapshot while one writer keeps updating;
+// ns/op is wall time over all readers' queries, so it drops as readers are added
+template <typename Tree>
+void bench_concurrent(const char *prefix, const vector<int64_t> &src, size_t m) {
+    const auto n = src.size();
+    auto q = Bench::ranges(n, m, 6);
+    auto bytes = Bench::live_bytes();
+    Tree st(src);
+    bytes = Bench::live_bytes() - bytes;
+    const unsigned hw = max(1u, thread::hardware_concurrency());
+    for (unsigned readers = 1; readers <= hw; readers *= 2) {
+        atomic<bool> stop = false;
+        thread writer([&]() {
+            auto g = Bench::rng(7);
+            while (!stop.load(memory_order_relaxed)) {
+                for (int i = 0; i < 64; ++i)
+                    st.update(g() % n, g() % 1000);
+                st.publish();
+            }
+        });
+        auto name = string(prefix) + "/query_halfopen(" + to_string(readers) + "r+1w)";
+        Bench::run(name.c_str(), n, m, bytes, [&]() {
+            vector<thread> pool;
+            for (unsigned k = 0; k < readers; ++k)
+                pool.emplace_back([&, k]() {
+                    int64_t acc = 0;
+                    for (size_t i = m*k/readers; i < m*(k + 1)/readers; ++i)
+                        acc += st.query_halfopen(q[i].first, q[i].second);
+                    Bench::keep(acc);
+                });
+            for (auto &t: pool)
+                t.join();
+        });
+        stop = true;
+        writer.join();
+    }
+}
+// 2D: square grid of side sqrt(n), random rectangles
+template <typename Tree>
+void bench_2d(const char *prefix, const vector<int64_t> &src, size_t m) {
+    const size_t side = sqrt(double(src.size())), n = side*side;
+    auto g = Bench::rng(9);
+    vector<tuple<size_t, size_t, size_t, size_t>> q(m);
+    for (auto &[u, l, b, r]: q) {
+        tie(u, b) = minmax<size_t>(g() % side, g() % side);
+        tie(l, r) = minmax<size_t>(g() % side, g() % side);
+        ++b, ++r;
+    }
+    auto name = [prefix](const char *op) { return string(prefix) + "/" + op; };
+    auto bytes = Bench::live_bytes();
+    auto st = Bench::build(name("build").c_str(), n, [&]() { return Tree(side, side, [it = src.cbegin()]() mutable { return *it++; }); });
+    bytes = Bench::live_bytes() - bytes;
+    Bench::run(name("update").c_str(), n, m, bytes, [&]() {
+        for (size_t i = 0; i < m; ++i)
+            st.update(g() % side, g() % side, g() % 1000);
+    });
+    Bench::run(name("query_halfopen").c_str(), n, m, bytes, [&]() {
+        int64_t acc = 0;
+        for (auto [u, l, b, r]: q)
+            acc += st.query_halfopen(u, l, b, r);
+        Bench::keep(acc);
+    });
+    if constexpr (requires { st.query_batch(q, span<int64_t>()); }) {
+        vector<int64_t> out(m);
+        Bench::run(name("query_batch").c_str(), n, m, bytes, [&]() {
+            st.query_batch(q, out);
+            Bench::keep(out.data());
+        });
+    }
+}
+int main(int argc, char *argv[]) {
+    using namespace SegmentTree;
+    typedef vector<int64_t> V;
+    Bench::header();
+    for (auto n: Bench::sizes(argc, argv)) {
+        const auto m = Bench::ops(n);
+        vector<int64_t> src(n);
+        auto g = Bench::rng();
+        for (auto &x: src)
+            x = g() % 1000;
+        bench_point_update_range_query<PointUpdateRangeQuery::SegTreeMin<V>>("segtree-min", src, m, FunctionalMin<int64_t>::neutral);
+        bench_point_update_range_query<PointUpdateRangeQuery::SegTreeMax<V>>("segtree-max", src, m, FunctionalMax<int64_t>::neutral);
+        bench_point_update_range_query<PointUpdateRangeQuery::SegTreeSum<V>>("segtree-sum", src, m, 0);
+        bench_search<PointUpdateRangeQuery::SegTreeSum<V>>("segtree-sum", src, m);
+        bench_point_update_range_query<PointUpdateRangeQueryWide::SegTreeMin<V>>("segtree-wide-min", src, m, FunctionalMin<int64_t>::neutral);
+        bench_point_update_range_query<PointUpdateRangeQueryWide::SegTreeSum<V>>("segtree-wide-sum", src, m, 0);
+        bench_search<PointUpdateRangeQueryWide::SegTreeSum<V>>("segtree-wide-sum", src, m);
+        if (n <= 10'000'000) {
+            bench_2d<PointUpdateRangeQuery2D::SegTreeSum<V>>("segtree-2d-sum", src, m);
+            bench_2d<PointUpdateRangeQuery2DTiled::SegTreeSum<V>>("segtree-2d-tiled-sum", src, m);
+        }
+        bench_concurrent<PointUpdateRangeQueryConcurrent::SegTreeMin<V>>("segtree-concurrent-min", src, m);
+        {
+            // persistent: every update makes a new version from a random older one, queries hit random versions
+            typedef PointUpdateRangeQueryPersistent::SegTreeSum<V> Tree;
+            auto q = Bench::ranges(n, m, 8);
+            auto bytes = Bench::live_bytes();
+            auto st = Bench::build("segtree-persistent-sum/build", n, [&]() { return Tree(src); });
+            bytes = Bench::live_bytes() - bytes;
+            vector<Tree::node_id> roots{st.root()};
+            roots.reserve(m + 1);
+            st.reserve(st.nodes() + m*(bit_width(n) + 1));
+            Bench::run("segtree-persistent-sum/update", n, m, bytes, [&]() {
+                for (size_t i = 0; i < m; ++i)
+                    roots.push_back(st.update(roots[g() % roots.size()], g() % n, g() % 1000));
+            });
+            Bench::run("segtree-persistent-sum/query_halfopen", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q)
+                    acc += st.query_halfopen(roots[g() % roots.size()], l, r);
+                Bench::keep(acc);
+            });
+            Bench::run("segtree-persistent-sum/compact(keep 1/16)", n, m, bytes, [&]() {
+                vector<Tree::node_id> keep;
+                for (size_t i = 0; i < roots.size(); i += 16)
+                    keep.push_back(roots[i]);
+                st.compact(keep);
+            });
+        }
+        {
+            // sparse: n random 64-bit keys, queries over random key ranges
+            vector<uint64_t> keys(n);
+            for (auto &k: keys)
+                k = g();
+            vector<pair<uint64_t, uint64_t>> kq(m);
+            for (auto &[l, r]: kq) {
+                l = keys[g() % n];
+                r = keys[g() % n];
+                if (l > r) swap(l, r);
+            }
+            auto bytes = Bench::live_bytes();
+            auto st = Bench::build("segtree-sparse-min/build(update)", n, [&]() {
+                PointUpdateRangeQuerySparse::SegTreeMin<V> st;
+                for (size_t i = 0; i < n; ++i)
+                    st.update(keys[i], src[i]);
+                return st;
+            });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("segtree-sparse-min/update", n, m, bytes, [&]() {
+                for (size_t i = 0; i < m; ++i)
+                    st.update(keys[g() % n], g() % 1000);
+            });
+            Bench::run("segtree-sparse-min/query", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: kq)
+                    acc += st.query(l, r);
+                Bench::keep(acc);
+            });
+            bytes = Bench::live_bytes();
+            auto dt = Bench::build("segtree-sparse-min/dense", n, [&]() { return st.dense(); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("segtree-sparse-min/dense/query", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: kq)
+                    acc += dt.query(l, r);
+                Bench::keep(acc);
+            });
+        }
+        {
+            // range update (add) + point query
+            auto q = Bench::ranges(n, m, 3);
+            vector<size_t> pos(m);
+            for (auto &x: pos)
+                x = g() % n;
+            auto bytes = Bench::live_bytes();
+            auto st = Bench::build("segtree-range-add/build", n, [&]() { return RangeUpdatePointQuery::SegTreeSum<V>(src.cbegin(), src.cend()); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("segtree-range-add/update_halfopen", n, m, bytes, [&]() {
+                for (auto [l, r]: q)
+                    st.update_halfopen(l, r, 1);
+            });
+            Bench::run("segtree-range-add/query", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto i: pos)
+                    acc += st.query(i);
+                Bench::keep(acc);
+            });
+        }
+        {
+            // lazy range add + range sum
+            auto q = Bench::ranges(n, m, 5);
+            vector<tuple<size_t, size_t, int64_t>> batch(m);
+            for (size_t i = 0; i < m; ++i)
+                batch[i] = { q[i].first, q[i].second, 1 };
+            auto bytes = Bench::live_bytes();
+            auto st = Bench::build("segtree-lazy-sum-add/build", n, [&]() { return RangeUpdateRangeQueryLazy::SegTreeSumAdd<V>(src.cbegin(), src.cend()); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::build("segtree-lazy-sum-add/build(parallel)", n, [&]() { return RangeUpdateRangeQueryLazy::SegTreeSumAdd<V>(src, 0u); });
+            Bench::run("segtree-lazy-sum-add/update_halfopen", n, m, bytes, [&]() {
+                for (auto [l, r]: q)
+                    st.update_halfopen(l, r, 1);
+            });
+            Bench::run("segtree-lazy-sum-add/update_halfopen(batch)", n, m, bytes, [&]() {
+                span<const tuple<size_t, size_t, int64_t>> b(batch);
+                for (size_t i = 0; i < m; i += 1024)
+                    st.update_halfopen(b.subspan(i, min<size_t>(1024, m - i)));
+            });
+            Bench::run("segtree-lazy-sum-add/query_halfopen", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q)
+                    acc += st.query_halfopen(l, r);
+                Bench::keep(acc);
+            });
+        }
+        {
+            // beats: same range add + range sum workload as the lazy tree above, then chmin/chmax
+            auto q = Bench::ranges(n, m, 5);
+            vector<int64_t> val(m);
+            for (auto &x: val)
+                x = g() % 1000;
+            auto bytes = Bench::live_bytes();
+            auto st = Bench::build("segtree-beats/build", n, [&]() { return RangeUpdateRangeQueryBeats::SegTree<V>(src); });
+            bytes = Bench::live_bytes() - bytes;
+            Bench::run("segtree-beats/range_add", n, m, bytes, [&]() {
+                for (auto [l, r]: q)
+                    st.range_add(l, r, 1);
+            });
+            Bench::run("segtree-beats/range_sum", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q)
+                    acc += st.range_sum(l, r);
+                Bench::keep(acc);
+            });
+            Bench::run("segtree-beats/range_chmin+chmax", n, m, bytes, [&]() {
+                for (size_t i = 0; i < m; ++i)
+                    if (i & 1)
+                        st.range_chmin(q[i].first, q[i].second, val[i] + m/n);
+                    else
+                        st.range_chmax(q[i].first, q[i].second, val[i]);
+            });
+            Bench::run("segtree-beats/range_sum(after chmin)", n, m, bytes, [&]() {
+                int64_t acc = 0;
+                for (auto [l, r]: q)
+                    acc += st.range_sum(l, r);
+                Bench::keep(acc);
+            });
+        }
+    }
+    return 0;
+}
+// vim: sw=4 et
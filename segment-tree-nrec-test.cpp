@@ -0,0 +1,105 @@
+#include "segment-tree-nrec.hpp"
+#include <bits/stdc++.h>
+using namespace std;
+using namespace SegmentTree;
+// segment tree beats against a plain vector: random chmin / chmax / add / sum / min / max
+template <typename T>
+void beats_random(mt19937_64 &rng, unsigned rounds, T lo, T hi, T max_add) {
+    for (unsigned t = 0; t < rounds; ++t) {
+        const size_t n = 1 + rng() % 70;
+        auto value = [&]() {
+            // mostly near the ends of [lo; hi], so that equal values and the limits show up
+            switch (rng() % 4) {
+                case 0: return T(lo + T(rng() % 3));
+                case 1: return T(hi - T(rng() % 3));
+                default: {
+                    const uint64_t span = uint64_t(hi) - uint64_t(lo) + 1; // 0: the whole type
+                    return T(uint64_t(lo) + (span ? rng() % span : rng()));
+                }
+            }
+        };
+        vector<T> a(n);
+        for (auto &x: a)
+            x = value();
+        RangeUpdateRangeQueryBeats::SegTree<vector<T>> st(a);
+        for (unsigned op = 0; op < 2000; ++op) {
+            size_t l = rng() % (n + 1), r = rng() % (n + 1);
+            if (l > r)
+                swap(l, r);
+            switch (rng() % 6) {
+                case 0: {
+                    const T v = value();
+                    st.range_chmin(l, r, v);
+                    for (auto i = l; i < r; ++i)
+                        a[i] = min(a[i], v);
+                    break;
+                }
+                case 1: {
+                    const T v = value();
+                    st.range_chmax(l, r, v);
+                    for (auto i = l; i < r; ++i)
+                        a[i] = max(a[i], v);
+                    break;
+                }
+                case 2: {
+                    // only adds that keep every value in [lo; hi]
+                    const T v = T(rng() % (uint64_t(max_add) + 1));
+                    if (l == r)
+                        break;
+                    const bool up = is_signed_v<T> ? rng() & 1 : *min_element(a.begin() + l, a.begin() + r) >= T(lo + v);
+                    if (up ? *max_element(a.begin() + l, a.begin() + r) > T(hi - v) : *min_element(a.begin() + l, a.begin() + r) < T(lo + v))
+                        break;
+                    st.range_add(l, r, up ? v : T(T(0) - v));
+                    for (auto i = l; i < r; ++i)
+                        a[i] = up ? T(a[i] + v) : T(a[i] - v);
+                    break;
+                }
+                case 3: {
+                    // unsigned sums wrap, like the tree's
+                    T sum = 0;
+                    for (auto i = l; i < r; ++i)
+                        sum = T(sum + a[i]);
+                    assert(st.range_sum(l, r) == sum);
+                    break;
+                }
+                case 4:
+                    assert(l == r || st.range_min(l, r) == *min_element(a.begin() + l, a.begin() + r));
+                    assert(l == r || st.range_max(l, r) == *max_element(a.begin() + l, a.begin() + r));
+                    break;
+                default:
+                    if (n)
+                        assert(st[l % n] == a[l % n]);
+            }
+        }
+        for (size_t i = 0; i < n; ++i)
+            assert(st[i] == a[i]);
+    }
+}
+int main() {
+    mt19937_64 rng;
+    {
+        // chmin / chmax down to a leaf whose only value is a limit
+        constexpr auto lowest = numeric_limits<int64_t>::lowest(), highest = numeric_limits<int64_t>::max();
+        RangeUpdateRangeQueryBeats::SegTree<vector<int64_t>> a(vector<int64_t>{-1, 1, 1, 1});
+        a.range_chmin(0, 1, lowest);
+        assert(a[0] == lowest && a.range_sum(0, 4) == lowest + 3 && a.range_min(0, 4) == lowest);
+        RangeUpdateRangeQueryBeats::SegTree<vector<int64_t>> b(vector<int64_t>{1, -1, -1, -1});
+        b.range_chmax(0, 1, highest);
+        assert(b[0] == highest && b.range_sum(0, 4) == highest - 3 && b.range_max(0, 4) == highest);
+        RangeUpdateRangeQueryBeats::SegTree<vector<uint64_t>> c(vector<uint64_t>{5, 0, 7, ~uint64_t(0)});
+        c.range_chmin(0, 4, 0);
+        assert(c.range_sum(0, 4) == 0 && c.range_max(0, 4) == 0);
+        c.range_chmax(0, 4, ~uint64_t(0));
+        assert(c.range_min(0, 4) == ~uint64_t(0) && c.range_sum(0, 4) == uint64_t(0) - 4);
+    }
+    beats_random<int64_t>(rng, 300, -20, 20, 5);
+    // large magnitudes; sums of up to 70 values and their differences fit in int64_t
+    beats_random<int64_t>(rng, 200, -(int64_t(1) << 55), int64_t(1) << 55, int64_t(1) << 50);
+    // values at the limits of the type: 0 is lowest(), ~0 is max(); no adds, as a pending
+    // add on a value since cut by chmin / chmax may wrap
+    beats_random<uint64_t>(rng, 300, 0, ~uint64_t(0), 0);
+    beats_random<int32_t>(rng, 200, -1000, 1000, 50);
+    cout << "ok" << endl;
+    return 0;
+}
+// vim: sw=4 et
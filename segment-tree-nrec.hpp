@@ -1,8 +1,19 @@
 #ifndef SEGMENT_TREE_NREC_HPP
 #define SEGMENT_TREE_NREC_HPP
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstdint>
 #include <iterator>
 #include <limits>
 #include <numeric>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 // See https://codeforces.com/blog/entry/18051
 // Title: "Efficient and easy segment trees"
 // Author: Al.Cash <https://codeforces.com/profile/Al.Cash>
@@ -21,8 +32,72 @@ namespace SegmentTree {
     template <typename T>
         struct FunctionalGCD {
             static constexpr T neutral = 0;
-            T operator() (const T a, const T b) { return std::gcd(a, b); }
+            T operator() (const T a, const T b) const { return std::gcd(a, b); }
         };
+    // neutral element of Combine: Combine::neutral if defined, value-initialized T otherwise (e.g. std::plus)
+    template <typename Combine, typename T, typename = void>
+        struct Neutral {
+            static constexpr T value = T{};
+        };
+    template <typename Combine, typename T>
+        struct Neutral<Combine, T, std::void_t<decltype(Combine::neutral)>> {
+            static constexpr T value = Combine::neutral;
+        };
+    // whether Combine is commutative: Combine::commutative if defined, true for std::plus, false otherwise
+    template <typename Combine, typename = void>
+        struct Commutative : std::false_type {};
+    template <typename T>
+        struct Commutative<std::plus<T>, void> : std::true_type {};
+    template <typename Combine>
+        struct Commutative<Combine, std::void_t<decltype(Combine::commutative)>> : std::bool_constant<Combine::commutative> {};
+    // random access in the C++17 sense (std::move_iterator is not a C++20 std::random_access_iterator)
+    template <typename Iterator>
+        concept RandomAccess = std::derived_from<typename std::iterator_traits<Iterator>::iterator_category, std::random_access_iterator_tag>;
+    // run f(0) ... f(threads - 1) concurrently, f(0) on the calling thread
+    template <typename F>
+        void parallel_run(unsigned threads, F f) {
+            std::vector<std::jthread> pool;
+            pool.reserve(threads);
+            for (unsigned i = 1; i < threads; ++i)
+                pool.emplace_back(f, i);
+            f(0u);
+        }
+    // threads == 0 means std::thread::hardware_concurrency()
+    inline unsigned parallel_threads(unsigned threads) {
+        return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Build of a bottom-up tree t[1; 2n) with leaves t[n; 2n) on up to `threads` threads.
+    // The first level [w; 2w) with w >= threads is split into `threads` chunks, and chunk i
+    // of every level below is the set of descendants of chunk i, so the columns are built
+    // independently (leaf(p) fills leaf p, node(p) computes inner node p from its children);
+    // the nodes above [w; 2w) are done on the calling thread.
+    // Allocating the container is still serial; default_init_allocator (default-init-allocator.hpp)
+    // avoids zero-filling it first.
+    template <typename Index, typename Leaf, typename Node>
+        void parallel_build(unsigned threads, Index n, Leaf leaf, Node node) {
+            if (n == 0)
+                return;
+            const Index c = std::min<Index>(parallel_threads(threads), n);
+            Index w = 1, top = 1;
+            while (w < c)
+                w <<= 1;
+            while (top <= (2*n - 1) >> 1)
+                top <<= 1;
+            parallel_run(c, [&](Index col) {
+                for (Index s = top/w; s; s >>= 1) {
+                    const Index lo = (w + col*w/c)*s, hi = (w + (col + 1)*w/c)*s;
+                    for (Index p = std::max(lo, n); p < std::min(hi, 2*n); ++p)
+                        leaf(p);
+                    for (Index p = std::min(hi, n); p-- > lo; )
+                        node(p);
+                }
+            });
+            for (Index p = w; p-- > 1; )
+                if (p < n)
+                    node(p);
+                else
+                    leaf(p);
+        }
     namespace PointUpdateRangeQuery {
         template<typename Container, typename Combine>
             class SegTree {
@@ -54,6 +129,18 @@ namespace SegmentTree {
                 }
                 SegTree(Container &&c, Combine combine = Combine()) : SegTree(c.size(), [begin = c.begin()]() mutable { return std::move(*begin++); }, combine) {
                 }
+                // parallel build on `threads` threads (0: std::thread::hardware_concurrency())
+                template <RandomAccess Iterator>
+                    SegTree(Iterator begin, Iterator end, unsigned threads, Combine combine = Combine()) : t((end - begin)*2), combine{combine} {
+                        const index_type n = size();
+                        parallel_build(threads, n,
+                                [this, begin, n](index_type p) { t[p] = begin[p - n]; },
+                                [this](index_type p) { t[p] = this->combine(std::as_const(t)[p<<1], std::as_const(t)[(p<<1)^1]); });
+                    }
+                SegTree(const Container &c, unsigned threads, Combine combine = Combine()) : SegTree(c.cbegin(), c.cend(), threads, combine) {
+                }
+                SegTree(Container &&c, unsigned threads, Combine combine = Combine()) : SegTree(std::make_move_iterator(c.begin()), std::make_move_iterator(c.end()), threads, combine) {
+                }
                 SegTree(const SegTree &) = default;
                 SegTree(SegTree &&) = default;
                 constexpr auto size () const noexcept { return t.size() >> 1; }
@@ -120,55 +207,148 @@ namespace SegmentTree {
                     }
                     return res;
                 }
-                // search for first index in [l; r) so that pred(query_halfopen(l, r, res)) is true
+                // out[i] = query_halfopen(q[i].first, q[i].second, neutral)
+                // answers batch_lanes queries in lock-step, so their cache misses overlap;
+                // per-level step is branch-free (combine with either node or neutral),
+                // so for arithmetic value_type with min/max/plus it compiles to cmov
+                // instead of the two unpredictable branches per level of query_halfopen.
+                // `neutral` must be neutral for combine (result is wrong otherwise)
+                static constexpr index_type batch_lanes = 16;
+                void query_batch(std::span<const std::pair<index_type, index_type>> q, std::span<value_type> out, const value_type &neutral) const {
+                    // assert(out.size() >= q.size());
+                    const index_type n = size();
+                    const value_type e = neutral;
+                    for (index_type base = 0; base < q.size(); base += batch_lanes) {
+                        const index_type lanes = std::min<index_type>(batch_lanes, q.size() - base);
+                        index_type l[batch_lanes], r[batch_lanes];
+                        value_type res[batch_lanes];
+                        bool active = false;
+                        for (index_type k = 0; k < batch_lanes; ++k) {
+                            // idle lanes run an empty query
+                            l[k] = k < lanes ? q[base + k].first + n : n;
+                            r[k] = k < lanes ? q[base + k].second + n : n;
+                            res[k] = neutral;
+                            active |= l[k] < r[k];
+                        }
+                        while (active) {
+                            active = false;
+                            for (index_type k = 0; k < batch_lanes; ++k) {
+                                const bool live = l[k] < r[k];
+                                const bool takel = live & (l[k] & 1);
+                                const bool taker = live & (r[k] & 1);
+                                // load unconditionally (unused loads go to always-cached root t[1])
+                                // and select through an index, so the compiler can't turn it into a branch
+                                const value_type lv[2] = { e, t[takel ? l[k] : 1] };
+                                const value_type rv[2] = { e, t[taker ? r[k] - 1 : 1] };
+                                res[k] = combine(res[k], lv[takel]);
+                                res[k] = combine(res[k], rv[taker]);
+                                l[k] = (l[k] + 1) >> 1;
+                                r[k] >>= 1;
+                                active |= l[k] < r[k];
+                            }
+                        }
+                        for (index_type k = 0; k < lanes; ++k)
+                            out[base + k] = std::move(res[k]);
+                    }
+                }
+                void query_batch(std::span<const std::pair<index_type, index_type>> q, std::span<value_type> out) const {
+                    query_batch(q, out, Neutral<Combine, value_type>::value);
+                }
+                private:
+                // nodes covering [l; r), left to right (any n: the subtree of such a node is
+                // leaves only at one depth, i.e. a contiguous range of elements)
+                index_type cover(index_type l, index_type r, index_type *out) const {
+                    const index_type n = size();
+                    index_type right[sizeof(index_type)*8], cnt = 0, rcnt = 0;
+                    for (l += n, r += n; l < r; l >>= 1, r >>= 1) {
+                        if ((l & 1))
+                            out[cnt++] = l++;
+                        if ((r & 1))
+                            right[rcnt++] = --r;
+                    }
+                    while (rcnt)
+                        out[cnt++] = right[--rcnt];
+                    return cnt;
+                }
+                public:
+                // search for first index in [l; r) so that pred(query_halfopen(l, index + 1, res)) is true, r if none
                 // expects tree partitioned in a way there exists index k in [l;r]
                 // such that for all i in [l;r) `pred(query_halfopen(l, i, res))` is same as `i >= k`
+                // O(log n) for any size: find the first covering node where pred turns true, then descend into it
                 template <typename Pred>
                 auto search_index_halfopen(index_type l, index_type r, value_type res, Pred pred) const { // [ l; r )
-#if 0
-                    if ((size() & (size() - 1)) == 0) {
-                        // O(log n)
-                        auto ll = l + n;
-                        auto rr = r + n;
-                        vector<pair<index_type, index_type>> stack;
-                        for (;;) {
-                            if (pred(res))
-                                break;
-                            if (ll >= rr) {
-                                if (stack.empty())
-                                    break;
-                                tie(ll, rr) = stack.back();
-                                stack.pop_back();
-                                continue;
+                    const index_type n = size();
+                    index_type nodes[2*sizeof(index_type)*8];
+                    const auto cnt = cover(l, r, nodes);
+                    for (index_type i = 0; i < cnt; ++i) {
+                        auto p = nodes[i];
+                        auto v = combine(res, t[p]);
+                        if (!pred(v)) {
+                            res = std::move(v);
+                            continue;
+                        }
+                        while (p < n) {
+                            p <<= 1;
+                            v = combine(res, t[p]);
+                            if (!pred(v)) {
+                                res = std::move(v);
+                                ++p;
                             }
-                            if ((ll & 1)) {
-                                res = combine(res, t[ll++]);
+                        }
+                        return p - n;
+                    }
+                    return r;
+                }
+                // out[i] = search_index_halfopen(0, size(), res, [&](auto &v) { return pred(v, keys[i]); })
+                // (e.g. pred = `v >= key` for "first index where prefix sum reaches key").
+                // The covering nodes are shared by all searches; the descents run batch_lanes at a time
+                // in lock-step with branch-free steps, so their cache misses overlap and the per-lane
+                // compare / select can be vectorized.
+                template <typename Key, typename Pred>
+                void search_index_batch(std::span<const Key> keys, std::span<index_type> out, const value_type &res, Pred pred) const {
+                    const index_type n = size();
+                    if (n == 0) {
+                        std::fill(out.begin(), out.begin() + keys.size(), 0);
+                        return;
+                    }
+                    index_type nodes[2*sizeof(index_type)*8];
+                    const auto cnt = cover(0, n, nodes);
+                    for (index_type base = 0; base < keys.size(); base += batch_lanes) {
+                        const index_type lanes = std::min(batch_lanes, keys.size() - base);
+                        index_type p[batch_lanes];
+                        value_type acc[batch_lanes];
+                        bool found[batch_lanes] = {};
+                        for (index_type k = 0; k < batch_lanes; ++k) {
+                            // idle lanes and lanes with no answer sit on a leaf
+                            p[k] = n;
+                            acc[k] = res;
+                            if (k >= lanes)
                                 continue;
-                            }
-                            if (ll < n) {
-                                auto tmp = combine(res, t[(ll<<1)]);
-                                if (pred(tmp)) {
-
+                            const auto &key = keys[base + k];
+                            for (index_type i = 0; i < cnt; ++i) {
+                                auto v = combine(acc[k], t[nodes[i]]);
+                                if ((found[k] = pred(v, key))) {
+                                    p[k] = nodes[i];
+                                    break;
                                 }
+                                acc[k] = std::move(v);
                             }
                         }
+                        for (bool active = true; active; ) {
+                            active = false;
+                            for (index_type k = 0; k < batch_lanes; ++k) {
+                                const bool inner = p[k] < n;
+                                const auto c = p[k] << inner;
+                                const value_type v[2] = { acc[k], combine(acc[k], t[c]) };
+                                const bool right = inner & !pred(v[1], keys[base + std::min(k, lanes - 1)]);
+                                acc[k] = v[right];
+                                p[k] = c + right;
+                                active |= inner;
+                            }
+                        }
+                        for (index_type k = 0; k < lanes; ++k)
+                            out[base + k] = found[k] ? p[k] - n : n;
                     }
-#endif
-                    // O(log^2 n)
-                    auto lo = l;
-                    auto hi = r;
-                    while(lo < hi) {
-                        auto mid = lo + (hi - lo)/2;
-                        auto midval = query_halfopen(lo, mid + 1, res);
-                        if (pred(midval))
-                            hi = mid;
-                        else {
-                            res = std::move(midval);
-                            lo = mid + 1;
-                        }
-                    }
-                    return lo;
-#endif
                 }
                 // extras
                 template <typename Result, typename Reduce>
@@ -282,6 +462,670 @@ namespace SegmentTree {
         template<typename Container>
         using SegTreeMax = SegTree<Container, FunctionalMax<typename Container::value_type>>;
     }
+    namespace PointUpdateRangeQueryWide {
+        // Same operations as PointUpdateRangeQuery::SegTree, but Branch-ary instead of binary:
+        // every level is stored contiguously and each group of Branch siblings is one block
+        // (a cache line by default), so a query touches O(log_Branch n) blocks
+        // instead of O(log_2 n) scattered nodes, at O(Branch) combines per level.
+        // Padding nodes hold Neutral<Combine, value_type>::value.
+        // For blocks to be exactly cache-line aligned, Container needs an aligned allocator.
+        template<typename Container, typename Combine,
+            typename Container::size_type Branch = std::max<typename Container::size_type>(2, 64/sizeof(typename Container::value_type))>
+            class SegTree {
+                static_assert(Branch >= 2);
+                typedef typename Container::size_type size_type;
+                typedef typename Container::size_type index_type;
+                typedef typename Container::value_type value_type;
+                Container t;
+                std::vector<index_type> m_off; // level k is t[m_off[k]; m_off[k + 1]), level 0 are leaves
+                index_type m_size;
+                [[no_unique_address]]
+                Combine combine;
+                static constexpr auto neutral() { return Neutral<Combine, value_type>::value; }
+                static std::vector<index_type> layout(index_type n) {
+                    std::vector<index_type> off;
+                    index_type s = 0;
+                    for (;;) {
+                        off.push_back(s);
+                        auto padded = (n + Branch - 1)/Branch*Branch;
+                        s += padded;
+                        if (n <= 1)
+                            break;
+                        n = padded/Branch;
+                    }
+                    off.push_back(s);
+                    return off;
+                }
+                constexpr index_type levels() const noexcept { return m_off.size() - 1; }
+                value_type fold(index_type c) const {
+                    value_type v = t[c];
+                    for (index_type i = 1; i < Branch; ++i)
+                        v = combine(v, t[c + i]);
+                    return v;
+                }
+                // combine of t[c + lo] ... t[c + hi - 1]
+                value_type fold(index_type c, index_type lo, index_type hi, const value_type &e) const {
+                    value_type x[Branch];
+                    for (index_type i = 0; i < Branch; ++i)
+                        x[i] = t[c + i];
+                    for (index_type i = 0; i < Branch; ++i)
+                        x[i] = (i >= lo) & (i < hi) ? x[i] : e;
+                    value_type v = x[0];
+                    for (index_type i = 1; i < Branch; ++i)
+                        v = combine(v, x[i]);
+                    return v;
+                }
+                public:
+                SegTree(index_type size, Combine combine = Combine()) : m_off(layout(size)), m_size(size), combine{combine} {
+                    t.resize(m_off.back(), neutral());
+                }
+                template <typename Source>
+                    SegTree(index_type size, Source src, Combine combine = Combine()) : SegTree(size, combine) {
+                        init(src);
+                    }
+                SegTree(index_type size, const value_type &initv, Combine combine = Combine()) : SegTree(size, combine) {
+                    reset(initv);
+                }
+                template <typename Iterator>
+                    SegTree(Iterator begin, Iterator end, Combine combine = Combine()) : SegTree(std::distance(begin, end), [begin]() mutable { return *begin++; }, combine) {
+                    }
+                SegTree(const Container &c, Combine combine = Combine()) : SegTree(c.cbegin(), c.cend(), combine) {
+                }
+                SegTree(Container &&c, Combine combine = Combine()) : SegTree(c.size(), [begin = c.begin()]() mutable { return std::move(*begin++); }, combine) {
+                }
+                // parallel build on `threads` threads (0: std::thread::hardware_concurrency())
+                template <RandomAccess Iterator>
+                    SegTree(Iterator begin, Iterator end, unsigned threads, Combine combine = Combine()) : SegTree(end - begin, combine) {
+                        threads = parallel_threads(threads);
+                        chunked(threads, m_size, [this, begin](index_type lo, index_type hi) {
+                            for (index_type i = lo; i < hi; ++i)
+                                t[i] = begin[i];
+                        });
+                        init(threads);
+                    }
+                SegTree(const Container &c, unsigned threads, Combine combine = Combine()) : SegTree(c.cbegin(), c.cend(), threads, combine) {
+                }
+                SegTree(Container &&c, unsigned threads, Combine combine = Combine()) : SegTree(std::make_move_iterator(c.begin()), std::make_move_iterator(c.end()), threads, combine) {
+                }
+                SegTree(const SegTree &) = default;
+                SegTree(SegTree &&) = default;
+                constexpr auto size () const noexcept { return m_size; }
+                template<typename Source>
+                    void init(Source src) {
+                        for (index_type i = 0; i < m_size; i++)
+                            t[i] = src();
+                        init();
+                    }
+                void reset(const value_type &initv) {
+                    std::fill(t.begin(), t.begin() + m_size, initv);
+                    init();
+                }
+                private:
+                // f(lo, hi) on [0; n) split into up to `threads` chunks; small ranges stay on the calling thread
+                template <typename F>
+                    static void chunked(unsigned threads, index_type n, F f) {
+                        const index_type c = std::min<index_type>(threads, n/4096 + 1);
+                        parallel_run(c, [&](index_type i) { f(n*i/c, n*(i + 1)/c); });
+                    }
+                void init(unsigned threads = 1) {
+                    // time = O(n); levels are built one after another, each level in parallel chunks
+                    for (index_type k = 1; k < levels(); ++k) {
+                        const auto cnt = (m_off[k] - m_off[k - 1])/Branch;
+                        chunked(threads, cnt, [this, k](index_type lo, index_type hi) {
+                            for (index_type j = lo; j < hi; ++j)
+                                t[m_off[k] + j] = fold(m_off[k - 1] + j*Branch);
+                        });
+                    }
+                }
+                public:
+                void update(index_type pos, const value_type &val) {
+                    // time = O(Branch*log_Branch n)
+                    t[pos] = val;
+                    for (index_type k = 1; k < levels(); ++k) {
+                        pos /= Branch;
+                        t[m_off[k] + pos] = fold(m_off[k - 1] + pos*Branch);
+                    }
+                }
+                const auto &query(index_type index) const {
+                    return t[index];
+                }
+                auto query_halfopen(index_type l, index_type r, value_type res) const { // [ l; r )
+                    // per level: one masked fold of the block holding l and one of the block holding r - 1;
+                    // fixed trip count and select instead of branches, so the folds vectorize
+                    const value_type e = neutral();
+                    // blocks of all levels are known up front, fetch them all before folding,
+                    // so the cache misses overlap instead of being spread between folds
+                    for (index_type k = 0, pl = l, pr = r; pl < pr; ++k) {
+                        __builtin_prefetch(&t[m_off[k] + pl]);
+                        __builtin_prefetch(&t[m_off[k] + pr - 1]);
+                        pl = pl/Branch + 1;
+                        pr = (pr - 1)/Branch;
+                    }
+                    for (index_type k = 0; l < r; ++k) {
+                        const auto o = m_off[k];
+                        const auto lblk = l/Branch*Branch;
+                        const auto rblk = (r - 1)/Branch*Branch;
+                        const auto lo = l - lblk;
+                        const auto hi = r - rblk; // 1..Branch
+                        if (lblk == rblk) {
+                            res = combine(res, fold(o + lblk, lo, hi, e));
+                            break;
+                        }
+                        res = combine(res, fold(o + lblk, lo, Branch, e));
+                        res = combine(res, fold(o + rblk, 0, hi, e));
+                        l = lblk/Branch + 1;
+                        r = rblk/Branch;
+                    }
+                    return res;
+                }
+                auto query(index_type l, index_type r, value_type res) const { // [ l; r]
+                    return query_halfopen(l, r + 1, res);
+                }
+                // search for first index in [l; r) so that pred(query_halfopen(l, index + 1, res)) is true,
+                // returns r if there is none
+                // expects tree partitioned in a way there exists index k in [l;r]
+                // such that for all i in [l;r) `pred(query_halfopen(l, i + 1, res))` is same as `i >= k`
+                // time = O(Branch*log_Branch n)
+                template <typename Pred>
+                auto search_index_halfopen(index_type l, index_type r, value_type res, Pred pred) const { // [ l; r )
+                    const auto r0 = r;
+                    // descend from node i at level k to the leaf where pred turns true
+                    auto descend = [&](index_type k, index_type i) {
+                        while (k-- > 0) {
+                            i *= Branch;
+                            for (;; ++i) {
+                                auto tmp = combine(res, t[m_off[k] + i]);
+                                if (pred(tmp))
+                                    break;
+                                res = std::move(tmp);
+                            }
+                        }
+                        return i;
+                    };
+                    // right-hand partial blocks, visited top-down after the ascent
+                    index_type rk[sizeof(index_type)*8], rl[sizeof(index_type)*8], rr[sizeof(index_type)*8];
+                    unsigned sp = 0;
+                    for (index_type k = 0; l < r; ++k) {
+                        const auto o = m_off[k];
+                        const auto lb = (l + Branch - 1)/Branch*Branch;
+                        const auto rb = r/Branch*Branch;
+                        const auto le = lb > rb ? r : lb;
+                        for (; l < le; ++l) {
+                            auto tmp = combine(res, t[o + l]);
+                            if (pred(tmp))
+                                return descend(k, l);
+                            res = std::move(tmp);
+                        }
+                        if (lb > rb)
+                            break;
+                        if (rb < r) {
+                            rk[sp] = k; rl[sp] = rb; rr[sp] = r;
+                            ++sp;
+                        }
+                        l = lb/Branch;
+                        r = rb/Branch;
+                    }
+                    while (sp--) {
+                        const auto o = m_off[rk[sp]];
+                        for (auto i = rl[sp]; i < rr[sp]; ++i) {
+                            auto tmp = combine(res, t[o + i]);
+                            if (pred(tmp))
+                                return descend(rk[sp], i);
+                            res = std::move(tmp);
+                        }
+                    }
+                    return r0;
+                }
+                auto operator [](size_type index) const {
+                    return query(index);
+                }
+                auto front() const { return (*this)[0]; }
+                auto back() const { return (*this)[size() - 1]; }
+            };
+        template<typename Container>
+        using SegTreeSum = SegTree<Container, std::plus<typename Container::value_type>>;
+        template<typename Container>
+        using SegTreeMin = SegTree<Container, FunctionalMin<typename Container::value_type>>;
+        template<typename Container>
+        using SegTreeMax = SegTree<Container, FunctionalMax<typename Container::value_type>>;
+    }
+    namespace PointUpdateRangeQueryConcurrent {
+        // PointUpdateRangeQuery::SegTree for one writer thread and any number of reader threads
+        // ("left-right" scheme: two copies, readers use the front one, the writer the back one).
+        // Readers never block, retry or write to the tree; each query sees a consistent snapshot,
+        // the state as of the latest publish(). update() is applied to the back copy and logged;
+        // publish() swaps the copies, waits until no reader uses the old front, and replays the
+        // log on it. Memory is twice that of SegTree; a publish costs O(reader_slots) besides the
+        // replay, so batching updates between publishes amortizes it.
+        template<typename Container, typename Combine>
+            class SegTree {
+                typedef typename Container::size_type size_type;
+                typedef typename Container::size_type index_type;
+                typedef typename Container::value_type value_type;
+                typedef PointUpdateRangeQuery::SegTree<Container, Combine> tree_type;
+                public:
+                static constexpr unsigned reader_slots = 64;
+                private:
+                struct alignas(64) Counter {
+                    std::atomic<std::size_t> n = 0;
+                };
+                tree_type m_tree[2];
+                std::atomic<unsigned> m_front = 0;
+                std::atomic<unsigned> m_arrive = 0;
+                mutable Counter m_readers[2][reader_slots];
+                std::vector<std::pair<index_type, value_type>> m_log;
+                explicit SegTree(tree_type &&t) : m_tree{t, std::move(t)} {
+                }
+                static unsigned slot() {
+                    static std::atomic<unsigned> next = 0;
+                    thread_local const unsigned s = next.fetch_add(1, std::memory_order_relaxed) % reader_slots;
+                    return s;
+                }
+                void wait_readers(unsigned a) const {
+                    for (auto &c: m_readers[a])
+                        while (c.n.load() != 0)
+                            std::this_thread::yield();
+                }
+                public:
+                SegTree(index_type size, Combine combine = Combine()) : SegTree(tree_type(size, combine)) {
+                }
+                SegTree(index_type size, const value_type &initv, Combine combine = Combine()) : SegTree(tree_type(size, initv, combine)) {
+                }
+                template <typename Iterator>
+                    SegTree(Iterator begin, Iterator end, Combine combine = Combine()) : SegTree(tree_type(begin, end, combine)) {
+                    }
+                SegTree(const Container &c, Combine combine = Combine()) : SegTree(tree_type(c, combine)) {
+                }
+                SegTree(Container &&c, Combine combine = Combine()) : SegTree(tree_type(std::move(c), combine)) {
+                }
+                SegTree(const SegTree &) = delete;
+                constexpr auto size () const noexcept { return m_tree[0].size(); }
+                // reader side: f(const tree_type &) on a snapshot; it must not keep references to it
+                template <typename F>
+                    auto read(F f) const {
+                        auto &c = m_readers[m_arrive.load()][slot()].n;
+                        c.fetch_add(1);
+                        struct Depart {
+                            std::atomic<std::size_t> &c;
+                            ~Depart() { c.fetch_sub(1); }
+                        } depart{c};
+                        return f(std::as_const(m_tree[m_front.load()]));
+                    }
+                value_type query(index_type index) const {
+                    return read([index](const tree_type &t) -> value_type { return t.query(index); });
+                }
+                auto query_halfopen(index_type l, index_type r, const value_type &res) const { // [ l; r )
+                    return read([l, r, &res](const tree_type &t) { return t.query_halfopen(l, r, res); });
+                }
+                auto query_halfopen(index_type l, index_type r) const {
+                    return query_halfopen(l, r, Neutral<Combine, value_type>::value);
+                }
+                auto query(index_type l, index_type r, const value_type &res) const { // [ l; r ]
+                    return query_halfopen(l, r + 1, res);
+                }
+                // writer side (one thread at a time): not visible to readers until publish()
+                void update(index_type pos, const value_type &val) {
+                    m_tree[m_front.load(std::memory_order_relaxed) ^ 1].update(pos, val);
+                    m_log.emplace_back(pos, val);
+                }
+                void publish() {
+                    if (m_log.empty())
+                        return;
+                    const auto back = m_front.load(std::memory_order_relaxed) ^ 1;
+                    m_front.store(back);
+                    // readers that arrived on either indicator may still use the old front
+                    const auto a = m_arrive.load(std::memory_order_relaxed);
+                    wait_readers(a ^ 1);
+                    m_arrive.store(a ^ 1);
+                    wait_readers(a);
+                    for (auto &[pos, val]: m_log)
+                        m_tree[back ^ 1].update(pos, val);
+                    m_log.clear();
+                }
+            };
+        template<typename Container>
+        using SegTreeSum = SegTree<Container, std::plus<typename Container::value_type>>;
+        template<typename Container>
+        using SegTreeMin = SegTree<Container, FunctionalMin<typename Container::value_type>>;
+        template<typename Container>
+        using SegTreeMax = SegTree<Container, FunctionalMax<typename Container::value_type>>;
+    }
+    namespace PointUpdateRangeQueryPersistent {
+        // Persistent point update / range query tree: update() never modifies existing nodes,
+        // it copies the root-to-leaf path (O(log n) new nodes) and returns the new version's root,
+        // and every query takes the root of the version to query.
+        // The tree is a perfect binary tree over [0; 2^h), 2^h >= n; padding subtrees share one
+        // chain of neutral (Neutral<Combine, value_type>::value) nodes.
+        // Nodes live in one arena (a vector, ids are 32-bit offsets); nothing is freed per version,
+        // compact() drops all versions not passed to it at once, in O(live nodes).
+        template<typename Container, typename Combine>
+            class SegTree {
+                typedef typename Container::size_type size_type;
+                typedef typename Container::size_type index_type;
+                typedef typename Container::value_type value_type;
+                public:
+                typedef std::uint32_t node_id;
+                static constexpr node_id npos = std::numeric_limits<node_id>::max();
+                private:
+                struct Node {
+                    value_type v;
+                    node_id l, r; // npos for leaves
+                };
+                std::vector<Node> m_nodes;
+                index_type m_size;
+                index_type m_height;
+                node_id m_root;
+                [[no_unique_address]]
+                Combine combine;
+                static constexpr auto neutral() { return Neutral<Combine, value_type>::value; }
+                node_id alloc(const Node &node) {
+                    m_nodes.push_back(node);
+                    return m_nodes.size() - 1;
+                }
+                template <typename Source>
+                    void init(Source src) {
+                        for (m_height = 0; (index_type(1) << m_height) < m_size; ++m_height)
+                            ;
+                        m_nodes.reserve(2*m_size + 2*m_height + 1);
+                        std::vector<node_id> level(m_size), zero(m_height + 1);
+                        zero[0] = alloc({neutral(), npos, npos});
+                        for (index_type k = 1; k <= m_height; ++k)
+                            zero[k] = alloc({neutral(), zero[k - 1], zero[k - 1]});
+                        for (auto &id: level)
+                            id = alloc({src(), npos, npos});
+                        for (index_type k = 0; k < m_height; ++k) {
+                            for (index_type i = 0; i < level.size(); i += 2) {
+                                const auto l = level[i], r = i + 1 < level.size() ? level[i + 1] : zero[k];
+                                level[i >> 1] = alloc({combine(m_nodes[l].v, m_nodes[r].v), l, r});
+                            }
+                            level.resize((level.size() + 1) >> 1);
+                        }
+                        m_root = m_size ? level[0] : zero[0];
+                    }
+                public:
+                SegTree(index_type size, Combine combine = Combine()) : SegTree(size, value_type(), combine) {
+                }
+                SegTree(index_type size, const value_type &initv, Combine combine = Combine()) : m_size(size), combine{combine} {
+                    init([&initv]() { return initv; });
+                }
+                template <typename Iterator>
+                    SegTree(Iterator begin, Iterator end, Combine combine = Combine()) : m_size(std::distance(begin, end)), combine{combine} {
+                        init([begin]() mutable { return *begin++; });
+                    }
+                SegTree(const Container &c, Combine combine = Combine()) : SegTree(c.cbegin(), c.cend(), combine) {
+                }
+                SegTree(Container &&c, Combine combine = Combine()) : SegTree(std::make_move_iterator(c.begin()), std::make_move_iterator(c.end()), combine) {
+                }
+                SegTree(const SegTree &) = default;
+                SegTree(SegTree &&) = default;
+                constexpr auto size () const noexcept { return m_size; }
+                // root of the version built by the constructor
+                constexpr node_id root() const noexcept { return m_root; }
+                // number of nodes in the arena, all versions included
+                auto nodes() const noexcept { return m_nodes.size(); }
+                void reserve(size_type nodes) { m_nodes.reserve(nodes); }
+                // root of the version `root` with element pos set to val; allocates h + 1 nodes
+                node_id update(node_id root, index_type pos, const value_type &val) {
+                    node_id path[sizeof(index_type)*8 + 1] = {};
+                    node_id id = root;
+                    for (index_type k = m_height + 1; k--; ) {
+                        path[k] = alloc(m_nodes[id]);
+                        if (k)
+                            id = (pos >> (k - 1)) & 1 ? m_nodes[id].r : m_nodes[id].l;
+                    }
+                    m_nodes[path[0]].v = val;
+                    for (index_type k = 1; k <= m_height; ++k) {
+                        auto &node = m_nodes[path[k]];
+                        ((pos >> (k - 1)) & 1 ? node.r : node.l) = path[k - 1];
+                        node.v = combine(m_nodes[node.l].v, m_nodes[node.r].v);
+                    }
+                    return path[m_height];
+                }
+                value_type query(node_id root, index_type index) const {
+                    for (index_type k = m_height; k--; )
+                        root = (index >> k) & 1 ? m_nodes[root].r : m_nodes[root].l;
+                    return m_nodes[root].v;
+                }
+                value_type query_halfopen(node_id root, index_type l, index_type r, value_type res) const { // [ l; r )
+                    // left-to-right traversal of the O(log n) nodes covering [l; r)
+                    struct Item {
+                        node_id id;
+                        index_type lo, k; // covers [lo; lo + 2^k)
+                    } stack[2*sizeof(index_type)*8 + 2];
+                    index_type top = 0;
+                    stack[top++] = {root, 0, m_height};
+                    while (top) {
+                        const auto [id, lo, k] = stack[--top];
+                        const auto hi = lo + (index_type(1) << k);
+                        if (r <= lo || hi <= l)
+                            continue;
+                        if (l <= lo && hi <= r) {
+                            res = combine(res, m_nodes[id].v);
+                            continue;
+                        }
+                        const auto mid = lo + (index_type(1) << (k - 1));
+                        stack[top++] = {m_nodes[id].r, mid, k - 1};
+                        stack[top++] = {m_nodes[id].l, lo, k - 1};
+                    }
+                    return res;
+                }
+                value_type query_halfopen(node_id root, index_type l, index_type r) const {
+                    return query_halfopen(root, l, r, neutral());
+                }
+                value_type query(node_id root, index_type l, index_type r) const { // [ l; r ]
+                    return query_halfopen(root, l, r + 1);
+                }
+                // Keeps only the versions in `roots` (rewritten in place to their new ids) and
+                // reclaims every other node. Relative order of nodes is kept, so it runs in place.
+                // root() is invalid afterwards unless it was passed in `roots`.
+                void compact(std::span<node_id> roots) {
+                    std::vector<node_id> remap(m_nodes.size(), npos);
+                    std::vector<node_id> stack;
+                    for (auto root: roots) {
+                        stack.push_back(root);
+                        while (!stack.empty()) {
+                            auto id = stack.back();
+                            stack.pop_back();
+                            if (id == npos || remap[id] != npos)
+                                continue;
+                            remap[id] = 0;
+                            stack.push_back(m_nodes[id].l);
+                            stack.push_back(m_nodes[id].r);
+                        }
+                    }
+                    node_id cnt = 0;
+                    for (auto &id: remap)
+                        if (id != npos)
+                            id = cnt++;
+                    for (node_id i = 0; i < m_nodes.size(); ++i)
+                        if (remap[i] != npos) {
+                            auto node = m_nodes[i];
+                            if (node.l != npos) {
+                                node.l = remap[node.l];
+                                node.r = remap[node.r];
+                            }
+                            m_nodes[remap[i]] = std::move(node);
+                        }
+                    m_nodes.erase(m_nodes.begin() + cnt, m_nodes.end());
+                    m_nodes.shrink_to_fit();
+                    for (auto &root: roots)
+                        root = remap[root];
+                    m_root = m_root == npos ? npos : remap[m_root];
+                }
+            };
+        template<typename Container>
+        using SegTreeSum = SegTree<Container, std::plus<typename Container::value_type>>;
+        template<typename Container>
+        using SegTreeMin = SegTree<Container, FunctionalMin<typename Container::value_type>>;
+        template<typename Container>
+        using SegTreeMax = SegTree<Container, FunctionalMax<typename Container::value_type>>;
+    }
+    namespace PointUpdateRangeQuerySparse {
+        // Dense form of a frozen SegTree below: sorted keys plus a PointUpdateRangeQuery::SegTree
+        // over their values; key ranges are mapped to index ranges by binary search.
+        template<typename Container, typename Combine, typename Key = std::uint64_t>
+            class DenseSegTree {
+                typedef typename Container::size_type size_type;
+                typedef typename Container::size_type index_type;
+                typedef typename Container::value_type value_type;
+                std::vector<Key> m_keys;
+                PointUpdateRangeQuery::SegTree<Container, Combine> t;
+                public:
+                DenseSegTree(std::vector<Key> &&keys, Container &&values, Combine combine = Combine()) : m_keys(std::move(keys)), t(std::move(values), combine) {
+                }
+                auto size() const noexcept { return m_keys.size(); }
+                const auto &keys() const noexcept { return m_keys; }
+                // key must be present
+                void update(Key key, const value_type &val) {
+                    t.update(std::lower_bound(m_keys.begin(), m_keys.end(), key) - m_keys.begin(), val);
+                }
+                value_type query(Key l, Key r, const value_type &res) const { // [ l; r ]
+                    return t.query_halfopen(std::lower_bound(m_keys.begin(), m_keys.end(), l) - m_keys.begin(),
+                            std::upper_bound(m_keys.begin(), m_keys.end(), r) - m_keys.begin(), res);
+                }
+                value_type query(Key l, Key r) const { // [ l; r ]
+                    return query(l, r, Neutral<Combine, value_type>::value);
+                }
+            };
+        // Point update / range query over the whole key space [0; 2^bits) of an unsigned Key
+        // (e.g. 64-bit timestamps). Nodes are created on first touch of a key and come from one
+        // vector pool. Single-child chains are not stored: every inner node has two children and
+        // covers an aligned range [lo; lo + 2^k), so m keys take 2m - 1 nodes.
+        // Absent keys are Neutral<Combine, value_type>::value, which must be neutral for Combine.
+        template<typename Container, typename Combine, typename Key = std::uint64_t>
+            class SegTree {
+                static_assert(std::is_unsigned_v<Key>);
+                typedef typename Container::size_type size_type;
+                typedef typename Container::value_type value_type;
+                typedef std::uint32_t node_id;
+                static constexpr node_id npos = std::numeric_limits<node_id>::max();
+                static constexpr unsigned bits = std::numeric_limits<Key>::digits;
+                struct Node {
+                    value_type v;
+                    Key lo;
+                    node_id c[2]; // npos for leaves
+                    unsigned k;   // covers [lo; lo + 2^k)
+                };
+                std::vector<Node> m_nodes;
+                node_id m_root = npos;
+                [[no_unique_address]]
+                Combine combine;
+                static constexpr auto neutral() { return Neutral<Combine, value_type>::value; }
+                static constexpr Key last(const Node &x) {
+                    return x.k >= bits ? std::numeric_limits<Key>::max() : x.lo | ((Key(1) << x.k) - 1);
+                }
+                node_id alloc(const Node &node) {
+                    m_nodes.push_back(node);
+                    return m_nodes.size() - 1;
+                }
+                public:
+                SegTree(Combine combine = Combine()) : combine{combine} {
+                }
+                SegTree(const SegTree &) = default;
+                SegTree(SegTree &&) = default;
+                // number of keys touched so far
+                size_type size() const noexcept { return (m_nodes.size() + 1) >> 1; }
+                void reserve(size_type keys) { m_nodes.reserve(keys*2); }
+                void update(Key key, const value_type &val) {
+                    node_id path[bits + 1];
+                    unsigned depth = 0;
+                    node_id parent = npos;
+                    for (node_id id = m_root; ; ) {
+                        if (id == npos) {
+                            m_root = alloc({val, key, {npos, npos}, 0});
+                            break;
+                        }
+                        const auto x = m_nodes[id];
+                        if (key < x.lo || last(x) < key) {
+                            // split: new inner node over the smallest aligned range holding both
+                            const unsigned k = std::bit_width(Key(x.lo ^ key));
+                            const auto leaf = alloc({val, key, {npos, npos}, 0});
+                            const node_id c[2] = {leaf, id};
+                            const auto b = (key >> (k - 1)) & 1;
+                            const auto y = alloc({x.v, k >= bits ? Key(0) : Key(key >> k << k), {c[b], c[b ^ 1]}, k});
+                            (parent == npos ? m_root : m_nodes[parent].c[(key >> (m_nodes[parent].k - 1)) & 1]) = y;
+                            path[depth++] = y;
+                            break;
+                        }
+                        if (x.k == 0) {
+                            m_nodes[id].v = val;
+                            break;
+                        }
+                        path[depth++] = parent = id;
+                        id = x.c[(key >> (x.k - 1)) & 1];
+                    }
+                    while (depth--) {
+                        auto &x = m_nodes[path[depth]];
+                        x.v = combine(m_nodes[x.c[0]].v, m_nodes[x.c[1]].v);
+                    }
+                }
+                value_type query(Key key) const {
+                    for (auto id = m_root; id != npos; ) {
+                        const auto &x = m_nodes[id];
+                        if (key < x.lo || last(x) < key)
+                            break;
+                        if (x.k == 0)
+                            return x.v;
+                        id = x.c[(key >> (x.k - 1)) & 1];
+                    }
+                    return neutral();
+                }
+                value_type query(Key l, Key r, value_type res) const { // [ l; r ]
+                    node_id stack[2*bits + 2];
+                    unsigned top = 0;
+                    if (m_root != npos)
+                        stack[top++] = m_root;
+                    while (top) {
+                        const auto &x = m_nodes[stack[--top]];
+                        if (r < x.lo || last(x) < l)
+                            continue;
+                        if (l <= x.lo && last(x) <= r) {
+                            res = combine(res, x.v);
+                            continue;
+                        }
+                        stack[top++] = x.c[1];
+                        stack[top++] = x.c[0];
+                    }
+                    return res;
+                }
+                value_type query(Key l, Key r) const { // [ l; r ]
+                    return query(l, r, neutral());
+                }
+                value_type query_halfopen(Key l, Key r) const { // [ l; r ), l < r
+                    return query(l, r - 1);
+                }
+                // Rebuild into a dense tree over the touched keys (for when the key set is frozen).
+                DenseSegTree<Container, Combine, Key> dense() const {
+                    std::vector<Key> keys;
+                    Container values;
+                    keys.reserve(size());
+                    values.reserve(size());
+                    std::vector<node_id> stack;
+                    if (m_root != npos)
+                        stack.push_back(m_root);
+                    while (!stack.empty()) {
+                        const auto &x = m_nodes[stack.back()];
+                        stack.pop_back();
+                        if (x.k == 0) {
+                            keys.push_back(x.lo);
+                            values.push_back(x.v);
+                        } else {
+                            stack.push_back(x.c[1]);
+                            stack.push_back(x.c[0]);
+                        }
+                    }
+                    return DenseSegTree<Container, Combine, Key>(std::move(keys), std::move(values), combine);
+                }
+            };
+        template<typename Container, typename Key = std::uint64_t>
+        using SegTreeSum = SegTree<Container, std::plus<typename Container::value_type>, Key>;
+        template<typename Container, typename Key = std::uint64_t>
+        using SegTreeMin = SegTree<Container, FunctionalMin<typename Container::value_type>, Key>;
+        template<typename Container, typename Key = std::uint64_t>
+        using SegTreeMax = SegTree<Container, FunctionalMax<typename Container::value_type>, Key>;
+        template<typename Container, typename Key = std::uint64_t>
+        using SegTreeGCD = SegTree<Container, FunctionalGCD<typename Container::value_type>, Key>;
+    }
     namespace PointUpdateRangeQuery2D {
         template<typename Container, typename Combine>
             class SegTree {
@@ -422,6 +1266,228 @@ namespace SegmentTree {
         template<typename Container>
         using SegTreeMax = SegTree<Container, FunctionalMax<typename Container::value_type>>;
     }
+    // Heap-indexed binary tree nodes [1; 2n) grouped into subtrees of Levels levels, counted from
+    // the deepest level up, each stored as 2^Levels - 1 consecutive slots (in-subtree heap order),
+    // so a leaf-to-root path touches about log n / Levels blocks instead of log n cache lines.
+    // For n a power of two no slot is wasted; otherwise up to about half of them.
+    template <typename Index, unsigned Levels>
+        class BlockedTreeLayout {
+            static_assert(Levels >= 1);
+            Index m_depth = 0;        // level of the deepest nodes
+            std::vector<Index> m_base; // first block of band k, bands counted from the deepest level
+            Index m_blocks = 0;
+            public:
+            static constexpr Index block_size = (Index(1) << Levels) - 1;
+            BlockedTreeLayout(Index n) {
+                m_depth = std::bit_width(std::max<Index>(2*n - 1, 1)) - 1;
+                for (Index deepest = m_depth; ; deepest -= Levels) {
+                    const Index top = deepest >= Levels - 1 ? deepest - (Levels - 1) : 0;
+                    m_base.push_back(m_blocks);
+                    m_blocks += Index(1) << top;
+                    if (top == 0)
+                        break;
+                }
+            }
+            constexpr Index blocks() const noexcept { return m_blocks; }
+            // {block, slot in block} of node x
+            std::pair<Index, Index> operator()(Index x) const {
+                const Index d = std::bit_width(x) - 1, k = (m_depth - d)/Levels, deepest = m_depth - k*Levels;
+                const Index top = deepest >= Levels - 1 ? deepest - (Levels - 1) : 0, s = d - top;
+                const Index root = x >> s;
+                return {m_base[k] + root - (Index(1) << top), (x ^ (root << s) ^ (Index(1) << s)) - 1};
+            }
+        };
+    namespace PointUpdateRangeQuery2DTiled {
+        // Same tree as PointUpdateRangeQuery2D (outer tree over rows, inner tree over columns
+        // for every outer node, node (R, C) combines (2R, C) and (2R + 1, C)), but stored in square
+        // tiles: BlockedTreeLayout blocks of rows x blocks of columns, each tile contiguous and
+        // row-major inside, so the O(log^2) nodes of a query or an update hit O(log^2 / Levels^2) tiles.
+        // Like PointUpdateRangeQuery2D, combine is assumed commutative.
+        template<typename Container, typename Combine, unsigned Levels = 3>
+            class SegTree {
+                typedef typename Container::size_type size_type;
+                typedef typename Container::size_type index_type;
+                typedef typename Container::value_type value_type;
+                typedef BlockedTreeLayout<index_type, Levels> layout_type;
+                static constexpr index_type bs = layout_type::block_size;
+                Container t;
+                size_type m_height;
+                size_type m_width;
+                std::vector<index_type> m_row; // offset of outer node R; node (R, C) is t[m_row[R] + m_col[C]]
+                std::vector<index_type> m_col;
+                [[no_unique_address]]
+                Combine combine;
+                index_type row(index_type r) const { return m_row[r]; }
+                index_type col(index_type c) const { return m_col[c]; }
+                void layout() {
+                    const layout_type rows(m_height), cols(m_width);
+                    m_row.resize(2*m_height);
+                    m_col.resize(2*m_width);
+                    for (index_type r = 1; r < m_row.size(); ++r) {
+                        auto [b, o] = rows(r);
+                        m_row[r] = b*cols.blocks()*bs*bs + o*bs;
+                    }
+                    for (index_type c = 1; c < m_col.size(); ++c) {
+                        auto [b, o] = cols(c);
+                        m_col[c] = b*bs*bs + o;
+                    }
+                    t.resize(rows.blocks()*cols.blocks()*bs*bs);
+                }
+                public:
+                typedef std::tuple<index_type, index_type, index_type, index_type> rect_type; // { upper, left, bottom, right }
+                template <typename Source>
+                    SegTree(index_type height, index_type width, Source src, Combine combine = Combine()) : m_height(height), m_width(width), combine(combine) {
+                        layout();
+                        init(src);
+                    }
+                SegTree(index_type height, index_type width, Combine combine = Combine()) : SegTree(height, width, value_type(), combine) {
+                }
+                SegTree(index_type height, index_type width, const value_type &initv, Combine combine = Combine()) : SegTree(height, width, [&initv]() { return initv; }, combine) {
+                }
+                template <typename Iterator>
+                    SegTree(index_type width, Iterator begin, Iterator end, Combine combine = Combine()) : SegTree(std::distance(begin, end)/width, width, [begin]() mutable { return *begin++; }, combine) {
+                    }
+                SegTree(index_type width, const Container &c, Combine combine = Combine()) : SegTree(width, c.cbegin(), c.cend(), combine) {
+                }
+                SegTree(index_type width, Container &&c, Combine combine = Combine()) : SegTree(c.size()/width, width, [begin = c.begin()]() mutable { return std::move(*begin++); }, combine) {
+                }
+                template <typename VofV>
+                    SegTree(const VofV& c, Combine combine = Combine()) : SegTree(c.size(), c[0].size(), [ii=c.cbegin(), i=c[0].cbegin(), e=c[0].cend()] () mutable { if (i == e) { i = (++ii)->cbegin(); e = ii->cend(); } return *i++; }, combine) {} // VofV is expected to be non-empty vector<vector<T>>-alike type with same c[i].size()
+                SegTree(const SegTree &) = default;
+                SegTree(SegTree &&) = default;
+                constexpr auto width () const noexcept { return m_width; }
+                constexpr auto height () const noexcept { return m_height; }
+                private:
+                template<typename Source>
+                    void init(Source src) {
+                        // time = O(n*m)
+                        const auto n = width();
+                        const auto h = height();
+                        for (index_type r = h; r < 2*h; ++r) {
+                            const auto rp = row(r);
+                            for (index_type c = n; c < 2*n; ++c)
+                                t[rp + col(c)] = src();
+                            for (index_type c = n; c-- > 1; )
+                                t[rp + col(c)] = combine(std::as_const(t)[rp + col(c<<1)], std::as_const(t)[rp + col((c<<1)^1)]);
+                        }
+                        for (index_type r = h; r-- > 1; ) {
+                            const auto rp = row(r), ap = row(r<<1), bp = row((r<<1)^1);
+                            for (index_type c = 1; c < 2*n; ++c) {
+                                const auto cp = col(c);
+                                t[rp + cp] = combine(std::as_const(t)[ap + cp], std::as_const(t)[bp + cp]);
+                            }
+                        }
+                    }
+                public:
+                void update(index_type r, index_type c, const value_type &val) {
+                    // time = O(log n*log m)
+                    index_type cn[sizeof(index_type)*8], cp[sizeof(index_type)*8] = {}, cnt = 0;
+                    for (c += width(); c > 0; c >>= 1, ++cnt) {
+                        cn[cnt] = c;
+                        cp[cnt] = col(c);
+                    }
+                    r += height();
+                    auto rp = row(r);
+                    t[rp + cp[0]] = val;
+                    for (index_type i = 1; i < cnt; ++i)
+                        t[rp + cp[i]] = combine(std::as_const(t)[rp + cp[i - 1]], std::as_const(t)[rp + col(cn[i - 1]^1)]);
+                    for (r >>= 1; r > 0; r >>= 1) {
+                        const auto ap = row(r<<1), bp = row((r<<1)^1);
+                        rp = row(r);
+                        for (index_type i = 0; i < cnt; ++i)
+                            t[rp + cp[i]] = combine(std::as_const(t)[ap + cp[i]], std::as_const(t)[bp + cp[i]]);
+                    }
+                }
+                auto query(index_type i, index_type j) const {
+                    return t[row(height() + i) + col(width() + j)];
+                }
+                private:
+                // slots of the inner nodes covering [ll; rr), returns their count
+                index_type cover(index_type ll, index_type rr, index_type *out) const {
+                    index_type cnt = 0;
+                    for (auto l = ll + width(), r = rr + width(); l < r; l >>= 1, r >>= 1) {
+                        if ((l & 1))
+                            out[cnt++] = col(l++);
+                        if ((r & 1))
+                            out[cnt++] = col(--r);
+                    }
+                    return cnt;
+                }
+                public:
+                auto query_halfopen(index_type u, index_type ll, index_type b, index_type rr, value_type res = value_type {}) const { // [ upper, left; bottom, right )
+                    // time = O(log n*log m); the inner node set is the same for every outer node
+                    index_type cp[2*sizeof(index_type)*8];
+                    const auto cnt = cover(ll, rr, cp);
+                    auto fold = [&](index_type rp) {
+                        for (index_type i = 0; i < cnt; ++i)
+                            res = combine(res, t[rp + cp[i]]);
+                    };
+                    for (u += height(), b += height(); u < b; u >>= 1, b >>= 1) {
+                        if ((u & 1))
+                            fold(row(u++));
+                        if ((b & 1))
+                            fold(row(--b));
+                    }
+                    return res;
+                }
+                // out[i] = query_halfopen(q[i]..., neutral)
+                // (outer node, query) pairs are bucketed by outer node (counting sort), so queries
+                // sharing an outer node read its tiles back to back while they are cached; done in
+                // chunks of batch_size queries to keep the bookkeeping itself in cache
+                static constexpr index_type batch_size = 65536;
+                void query_batch(std::span<const rect_type> q, std::span<value_type> out, const value_type &neutral) const {
+                    const auto h = height();
+                    std::vector<index_type> cp, cstart, bucket, work;
+                    auto outer = [h](const rect_type &rect, auto f) {
+                        for (auto u = std::get<0>(rect) + h, b = std::get<2>(rect) + h; u < b; u >>= 1, b >>= 1) {
+                            if ((u & 1))
+                                f(u++);
+                            if ((b & 1))
+                                f(--b);
+                        }
+                    };
+                    index_type buf[2*sizeof(index_type)*8];
+                    for (index_type base = 0; base < q.size(); base += batch_size) {
+                        const auto qs = q.subspan(base, std::min(batch_size, q.size() - base));
+                        const auto os = out.subspan(base);
+                        cp.clear();
+                        cstart.assign(1, 0);
+                        bucket.assign(2*h + 1, 0);
+                        for (const auto &rect: qs) {
+                            cp.insert(cp.end(), buf, buf + cover(std::get<1>(rect), std::get<3>(rect), buf));
+                            cstart.push_back(cp.size());
+                            outer(rect, [&bucket](index_type r) { ++bucket[r + 1]; });
+                        }
+                        std::partial_sum(bucket.begin(), bucket.end(), bucket.begin());
+                        work.resize(bucket.back());
+                        for (index_type i = 0; i < qs.size(); ++i) {
+                            os[i] = neutral;
+                            outer(qs[i], [&bucket, &work, i](index_type r) { work[bucket[r]++] = i; });
+                        }
+                        // bucket[r] is now the end of outer node r's queries
+                        for (index_type r = 1, k = bucket[0]; r < 2*h; k = bucket[r++]) {
+                            const auto rp = row(r);
+                            for (; k < bucket[r]; ++k) {
+                                const auto i = work[k];
+                                auto res = os[i];
+                                for (auto j = cstart[i]; j < cstart[i + 1]; ++j)
+                                    res = combine(res, t[rp + cp[j]]);
+                                os[i] = res;
+                            }
+                        }
+                    }
+                }
+                void query_batch(std::span<const rect_type> q, std::span<value_type> out) const {
+                    query_batch(q, out, Neutral<Combine, value_type>::value);
+                }
+            };
+        template<typename Container>
+        using SegTreeSum = SegTree<Container, std::plus<typename Container::value_type>>;
+        template<typename Container>
+        using SegTreeMin = SegTree<Container, FunctionalMin<typename Container::value_type>>;
+        template<typename Container>
+        using SegTreeMax = SegTree<Container, FunctionalMax<typename Container::value_type>>;
+    }
     namespace RangeUpdatePointQuery {
         template<typename Container, typename Combine, typename Container::value_type Init>
             class SegTree {
@@ -447,6 +1513,16 @@ namespace SegmentTree {
                 }
                 SegTree(Container &&c, Combine combine = Combine()) : SegTree(c.size(), [begin = c.begin()]() mutable { return std::move(*begin++); }, combine) {
                 }
+                // parallel build on `threads` threads (0: std::thread::hardware_concurrency())
+                template <RandomAccess Iterator>
+                    SegTree(Iterator begin, Iterator end, unsigned threads, Combine combine = Combine()) : t((end - begin)*2, Init), combine{combine} {
+                        const index_type n = size();
+                        parallel_build(threads, n, [this, begin, n](index_type p) { t[p] = begin[p - n]; }, [](index_type) {});
+                    }
+                SegTree(const Container &c, unsigned threads, Combine combine = Combine()) : SegTree(c.cbegin(), c.cend(), threads, combine) {
+                }
+                SegTree(Container &&c, unsigned threads, Combine combine = Combine()) : SegTree(std::make_move_iterator(c.begin()), std::make_move_iterator(c.end()), threads, combine) {
+                }
                 SegTree(const SegTree &) = default;
                 SegTree(SegTree &&) = default;
                 constexpr auto size () const noexcept { return t.size() >> 1; }
@@ -518,47 +1594,131 @@ namespace SegmentTree {
         using SegTreeMax = SegTree<Container, FunctionalMax<typename Container::value_type>, FunctionalMax<typename Container::value_type>::neutral>;
     }
     namespace RangeUpdateRangeQueryLazy {
-        template<typename Container, typename CombineU, typename CombineQ, typename Container::value_type Init>
+        // Tag monoids ("what to do with a range") and matching apply functors.
+        // Compose must be callable as `tag_type compose(const tag_type &older, const tag_type &newer)`
+        // (newer applied after older) with identity Neutral<Compose, tag_type>::value;
+        // Apply must be callable as `value_type apply(const value_type &v, const tag_type &tag, index_type len)`,
+        // giving the aggregate of `len` elements after `tag` was applied to each of them, and must satisfy
+        //   apply(combine(a, b), tag, 2*len) == combine(apply(a, tag, len), apply(b, tag, len))
+        //   apply(apply(v, older, len), newer, len) == apply(v, compose(older, newer), len)
+        //   apply(v, neutral, len) == v
+        // Sum == true for sum aggregates (result depends on len), false for min/max.
+
+        // x += tag; compose is std::plus<T>
+        template <typename T, bool Sum>
+            struct ApplyAdd {
+                T operator() (const T &v, const T &tag, std::size_t len) const { return Sum ? v + tag*static_cast<T>(len) : v + tag; }
+            };
+        // x = assign ? value + add : x + add ("assign, then add")
+        template <typename T>
+            struct AssignAddTag {
+                bool assign;
+                T value;
+                T add;
+                bool operator == (const AssignAddTag &) const = default;
+            };
+        template <typename T>
+            struct ComposeAssignAdd {
+                typedef AssignAddTag<T> tag_type;
+                static constexpr tag_type neutral { false, T{}, T{} };
+                static constexpr tag_type assign(const T &v) { return { true, v, T{} }; }
+                static constexpr tag_type add(const T &v) { return { false, T{}, v }; }
+                tag_type operator() (const tag_type &older, const tag_type &newer) const {
+                    if (newer.assign)
+                        return newer;
+                    return { older.assign, older.value, older.add + newer.add };
+                }
+            };
+        template <typename T, bool Sum>
+            struct ApplyAssignAdd {
+                T operator() (const T &v, const AssignAddTag<T> &tag, std::size_t len) const {
+                    const auto n = static_cast<T>(Sum ? len : 1);
+                    return tag.assign ? (tag.value + tag.add)*n : v + tag.add*n;
+                }
+            };
+        // x = mul*x + add
+        template <typename T>
+            struct AffineTag {
+                T mul;
+                T add;
+                bool operator == (const AffineTag &) const = default;
+            };
+        template <typename T>
+            struct ComposeAffine {
+                typedef AffineTag<T> tag_type;
+                static constexpr tag_type neutral { 1, 0 };
+                tag_type operator() (const tag_type &older, const tag_type &newer) const {
+                    return { newer.mul*older.mul, newer.mul*older.add + newer.add };
+                }
+            };
+        template <typename T, bool Sum>
+            struct ApplyAffine {
+                // for Sum == false (min/max) mul must be non-negative
+                T operator() (const T &v, const AffineTag<T> &tag, std::size_t len) const {
+                    return tag.mul*v + tag.add*static_cast<T>(Sum ? len : 1);
+                }
+            };
+
+        template<typename Container, typename TagContainer, typename Combine, typename Compose, typename Apply>
             class SegTree {
-                // requires:
-                // combineU(combineQ(a, b), c) == combineQ(combineU(a, c), combineU(b, c))
-                // combineU(Init, a) == Init
-                // combineQ(Init, a) == Init
+                // Lazy propagation over (value monoid Combine, tag monoid Compose, Apply), see above.
+                // Tags are pushed only along the two boundary paths of an operation: time O(log n).
+                // Tags need not commute (e.g. assign then add), combine need not commute either;
+                // updates skip the push when Commutative<Compose> (e.g. std::plus).
+                // Queries push pending tags, so they are not const.
                 typedef typename Container::size_type size_type;
                 typedef typename Container::size_type index_type;
                 typedef typename Container::value_type value_type;
+                typedef typename TagContainer::value_type tag_type;
                 Container t;
-                Container d;
+                TagContainer d;
+                [[no_unique_address]]
+                Combine combine;
                 [[no_unique_address]]
-                CombineU combineU;
+                Compose compose;
                 [[no_unique_address]]
-                CombineQ combineQ;
+                Apply apply;
                 index_type h;
-                static unsigned ilog2(unsigned i) { return sizeof(i)*8 - __builtin_clz(i); }
-                static unsigned ilog2(unsigned long i) { return sizeof(i)*8 - __builtin_clzl(i); }
-                static unsigned ilog2(unsigned long long i) { return sizeof(i)*8 - __builtin_clzll(i); }
+                static constexpr auto neutral() { return Neutral<Combine, value_type>::value; }
+                static constexpr auto tag_neutral() { return Neutral<Compose, tag_type>::value; }
+                static index_type height(index_type n) {
+                    index_type h = 0;
+                    for (; n; n >>= 1)
+                        ++h;
+                    return h;
+                }
                 public:
-                SegTree(index_type size, CombineU combineU = CombineU(), CombineQ combineQ = CombineQ()) : t(size*2, Init), d(size, Init), combineU{combineU}, combineQ{combineQ}, h{ilog2(size)} {
-                    if (combineQ(Init, Init) != Init)
-                        init();
+                SegTree(index_type size, Combine combine = Combine(), Compose compose = Compose(), Apply apply = Apply()) : t(size*2), d(size, tag_neutral()), combine{combine}, compose{compose}, apply{apply}, h{height(size)} {
+                    init();
                 }
                 template <typename Source>
-                    SegTree(index_type size, Source src, CombineU combineU = CombineU(), CombineQ combineQ = CombineQ()) : t(size*2, Init), d(size, Init), combineU{combineU}, combineQ{combineQ}, h{ilog2(size)} {
+                    SegTree(index_type size, Source src, Combine combine = Combine(), Compose compose = Compose(), Apply apply = Apply()) : t(size*2), d(size, tag_neutral()), combine{combine}, compose{compose}, apply{apply}, h{height(size)} {
                         init(src);
                     }
-                SegTree(index_type size, const value_type &init, CombineU combineU = CombineU(), CombineQ combineQ = CombineQ()) : SegTree(size, [&init]() { return init; }, combineU, combineQ) {
-                    if (combineQ(init, init) != init)
-                        init();
+                SegTree(index_type size, const value_type &initv, Combine combine = Combine(), Compose compose = Compose(), Apply apply = Apply()) : SegTree(size, [&initv]() { return initv; }, combine, compose, apply) {
                 }
                 template <typename Iterator>
-                    SegTree(Iterator begin, Iterator end, CombineU combineU = CombineU(), CombineQ combineQ = CombineQ()) : SegTree(std::distance(begin, end), [begin]() mutable { return *begin++; }, combineU, combineQ) {
+                    SegTree(Iterator begin, Iterator end, Combine combine = Combine(), Compose compose = Compose(), Apply apply = Apply()) : SegTree(std::distance(begin, end), [begin]() mutable { return *begin++; }, combine, compose, apply) {
                     }
-                SegTree(const Container &c, CombineU combineU = CombineU(), CombineQ combineQ = CombineQ()) : SegTree(c.cbegin(), c.cend(), combineU, combineQ) {
+                SegTree(const Container &c, Combine combine = Combine(), Compose compose = Compose(), Apply apply = Apply()) : SegTree(c.cbegin(), c.cend(), combine, compose, apply) {
                 }
-                SegTree(Container &&c, CombineU combineU = CombineU(), CombineQ combineQ = CombineQ()) : SegTree(c.size(), [begin = c.begin()]() mutable { return std::move(*begin++); }, combineU, combineQ) {
+                SegTree(Container &&c, Combine combine = Combine(), Compose compose = Compose(), Apply apply = Apply()) : SegTree(c.size(), [begin = c.begin()]() mutable { return std::move(*begin++); }, combine, compose, apply) {
+                }
+                // parallel build on `threads` threads (0: std::thread::hardware_concurrency())
+                template <RandomAccess Iterator>
+                    SegTree(Iterator begin, Iterator end, unsigned threads, Combine combine = Combine(), Compose compose = Compose(), Apply apply = Apply()) : t((end - begin)*2), d(end - begin, tag_neutral()), combine{combine}, compose{compose}, apply{apply}, h{height(end - begin)} {
+                        const index_type n = size();
+                        parallel_build(threads, n,
+                                [this, begin, n](index_type p) { t[p] = begin[p - n]; },
+                                [this](index_type p) { t[p] = this->combine(std::as_const(t)[p<<1], std::as_const(t)[(p<<1)^1]); });
+                    }
+                SegTree(const Container &c, unsigned threads, Combine combine = Combine(), Compose compose = Compose(), Apply apply = Apply()) : SegTree(c.cbegin(), c.cend(), threads, combine, compose, apply) {
+                }
+                SegTree(Container &&c, unsigned threads, Combine combine = Combine(), Compose compose = Compose(), Apply apply = Apply()) : SegTree(std::make_move_iterator(c.begin()), std::make_move_iterator(c.end()), threads, combine, compose, apply) {
                 }
                 SegTree(const SegTree &) = default;
                 SegTree(SegTree &&) = default;
+                constexpr auto size () const noexcept { return t.size() >> 1; }
                 template<typename Source>
                     void init(Source src) {
                         index_type n = size();
@@ -568,88 +1728,383 @@ namespace SegmentTree {
                     }
                 void reset(const value_type &initv) {
                     index_type n = size();
-                    if (combineQ(initv, initv) == initv)
-                        fill(t.begin(), t.end(), initv);
-                    else {
-                        fill(t.begin() + n, t.end(), initv);
-                        init();
-                    }
+                    std::fill(t.begin() + n, t.end(), initv);
+                    init();
                 }
                 private:
                 void init() {
                     const index_type n = size();
-                    for (index_type i = n; i--; )
-                        t[i] = combineQ(std::as_const(t)[i<<1], std::as_const(t)[(i<<1)^1]);
+                    std::fill(d.begin(), d.end(), tag_neutral());
+                    for (index_type i = n; i-- > 1; )
+                        t[i] = combine(std::as_const(t)[i<<1], std::as_const(t)[(i<<1)^1]);
                 }
-                void update_t(index_type index) {
-                    const index_type n = size();
-                    while(index > 0) {
-                        auto next = index >> 1;
-                        t[next] = combineU(combineQ(std::as_const(t)[index], std::as_const(t)[index ^ 1]), d[next]);
-                        index = next;
-                    }
+                // node p covers len leaves
+                void apply_node(index_type p, const tag_type &tag, index_type len) {
+                    t[p] = apply(std::as_const(t)[p], tag, len);
+                    if (p < size())
+                        d[p] = compose(std::as_const(d)[p], tag);
                 }
-                void apply(index_type index, const value_type &val) {
-                    const index_type n = size();
-                    t[index] = combineU(std::as_const(t)[index], val);
-                    if (index < n)
-                        d[index] = combineU(d[index], val);
+                void calc(index_type p, index_type len) {
+                    t[p] = apply(combine(std::as_const(t)[p<<1], std::as_const(t)[(p<<1)^1]), std::as_const(d)[p], len);
+                }
+                // recompute ancestors of leaf nodes l and r, shared ones once
+                void build(index_type l, index_type r) {
+                    for (index_type len = 2; l > 1; len <<= 1) {
+                        l >>= 1, r >>= 1;
+                        calc(l, len);
+                        if (r != l)
+                            calc(r, len);
+                    }
                 }
+                // push pending tags down the path from root to leaf node p
                 void push(index_type p) {
-                    const index_type n = size();
                     for (index_type s = h; s > 0; --s) {
                         index_type i = p >> s;
-                        if (d[i] != Init) {
-                            apply((i << 1), d[i]);
-                            apply((i << 1) ^ 1, d[i]);
-                            d[i] = Init;
+                        if (i && !(std::as_const(d)[i] == tag_neutral())) {
+                            const index_type len = static_cast<index_type>(1) << (s - 1);
+                            apply_node(i<<1, d[i], len);
+                            apply_node((i<<1)^1, d[i], len);
+                            d[i] = tag_neutral();
                         }
                     }
                 }
+                // apply tag to [l; r) without recomputing ancestors of boundaries
+                void apply_range(index_type l, index_type r, const tag_type &tag) {
+                    const index_type n = size();
+                    l += n, r += n;
+                    // with commutative tags pending ones can stay above, calc() re-applies them
+                    if constexpr (!Commutative<Compose>::value) {
+                        push(l);
+                        push(r - 1);
+                    }
+                    for (index_type len = 1; l < r; l >>= 1, r >>= 1, len <<= 1) {
+                        if ((l & 1))
+                            apply_node(l++, tag, len);
+                        if ((r & 1))
+                            apply_node(--r, tag, len);
+                    }
+                }
                 public:
-                auto query_halfopen(index_type l, index_type r, value_type res) const { // [ l; r )
+                auto query_halfopen(index_type l, index_type r, value_type resl, value_type resr) { // [ l; r )
+                    if (l >= r)
+                        return combine(resl, resr);
                     const index_type n = size();
-                    l += n;
-                    r += n;
+                    l += n, r += n;
                     push(l);
                     push(r - 1);
                     for (; l < r; l >>= 1, r >>= 1) {
                         if ((l & 1))
-                            res = combineQ(res, t[l++]);
+                            resl = combine(resl, std::as_const(t)[l++]);
                         if ((r & 1))
-                            res = combineQ(t[--r], res);
+                            resr = combine(std::as_const(t)[--r], resr);
                     }
-                    return res;
+                    return combine(resl, resr);
                 }
-                auto query(index_type index) const {
+                auto query_halfopen(index_type l, index_type r, value_type res) { // [ l; r )
+                    return query_halfopen(l, r, res, neutral());
+                }
+                auto query_halfopen(index_type l, index_type r) { // [ l; r )
+                    return query_halfopen(l, r, neutral(), neutral());
+                }
+                auto query(index_type index) {
                     const index_type n = size();
                     index += n;
-                    //push(index);
-                    return t[index];
+                    push(index);
+                    return std::as_const(t)[index];
                 }
-                void update_halfopen(index_type l, index_type r, const value_type &val) { // [ l; r )
+                void update_halfopen(index_type l, index_type r, const tag_type &tag) { // [ l; r )
+                    if (l >= r)
+                        return;
                     const index_type n = size();
-                    l += n, r += n;
-                    auto l0 = l;
-                    auto r0 = r;
-                    for (; l < r; l >>= 1, r >>= 1) {
-                        if ((l & 1))
-                            apply(l++, val);
-                        if ((r & 1))
-                            apply(--r, val);
+                    apply_range(l, r, tag);
+                    build(l + n, r - 1 + n);
+                }
+                // same as calling update_halfopen(l, r, tag) for each (l, r, tag) in order,
+                // but ancestors of boundaries are recomputed once per batch instead of once per update
+                void update_halfopen(std::span<const std::tuple<index_type, index_type, tag_type>> batch) {
+                    const index_type n = size();
+                    std::vector<index_type> nodes;
+                    nodes.reserve(batch.size()*2);
+                    for (const auto &[l, r, tag]: batch) {
+                        if (l >= r)
+                            continue;
+                        apply_range(l, r, tag);
+                        nodes.push_back(l + n);
+                        nodes.push_back(r - 1 + n);
+                    }
+                    // level by level; equal neighbours are merged, so sorted (or clustered)
+                    // batches recompute each shared ancestor once; nodes may be recomputed
+                    // more than once otherwise, but always after their children
+                    for (index_type len = 2; !nodes.empty(); len <<= 1) {
+                        auto e = nodes.begin();
+                        for (auto p: nodes)
+                            if (p >>= 1; p && (e == nodes.begin() || e[-1] != p))
+                                *e++ = p;
+                        nodes.erase(e, nodes.end());
+                        for (auto p: nodes)
+                            calc(p, len);
                     }
-                    update_t(l0);
-                    update_t(r0 - 1);
                 }
-                constexpr auto size () noexcept { return t.size() >> 1; }
-                auto operator [](size_type index) const {
+                auto operator [](size_type index) {
+                    return query(index);
+                }
+            };
+        template<typename Container>
+        using SegTreeSumAdd = SegTree<Container, Container, std::plus<typename Container::value_type>, std::plus<typename Container::value_type>, ApplyAdd<typename Container::value_type, true>>;
+        template<typename Container>
+        using SegTreeMinAdd = SegTree<Container, Container, FunctionalMin<typename Container::value_type>, std::plus<typename Container::value_type>, ApplyAdd<typename Container::value_type, false>>;
+        template<typename Container>
+        using SegTreeMaxAdd = SegTree<Container, Container, FunctionalMax<typename Container::value_type>, std::plus<typename Container::value_type>, ApplyAdd<typename Container::value_type, false>>;
+        template<typename Container>
+        using SegTreeSumAssignAdd = SegTree<Container, std::vector<AssignAddTag<typename Container::value_type>>, std::plus<typename Container::value_type>, ComposeAssignAdd<typename Container::value_type>, ApplyAssignAdd<typename Container::value_type, true>>;
+        template<typename Container>
+        using SegTreeMinAssignAdd = SegTree<Container, std::vector<AssignAddTag<typename Container::value_type>>, FunctionalMin<typename Container::value_type>, ComposeAssignAdd<typename Container::value_type>, ApplyAssignAdd<typename Container::value_type, false>>;
+        template<typename Container>
+        using SegTreeMaxAssignAdd = SegTree<Container, std::vector<AssignAddTag<typename Container::value_type>>, FunctionalMax<typename Container::value_type>, ComposeAssignAdd<typename Container::value_type>, ApplyAssignAdd<typename Container::value_type, false>>;
+        template<typename Container>
+        using SegTreeSumAffine = SegTree<Container, std::vector<AffineTag<typename Container::value_type>>, std::plus<typename Container::value_type>, ComposeAffine<typename Container::value_type>, ApplyAffine<typename Container::value_type, true>>;
+    }
+    namespace RangeUpdateRangeQueryBeats {
+        // "Segment tree beats" (Ji Ruyi, 2016): range chmin / chmax / add with range sum / min / max
+        // in amortized O(log^2 n). Every node keeps sum, the two largest and two smallest distinct
+        // values with counts of the largest / smallest, and a pending add.
+        // A chmin only stops at nodes where it changes the maximum alone, otherwise it goes down;
+        // updates are an explicit-stack walk from the root over a perfect tree of 2^h >= n leaves
+        // (padding leaves have len 0 and are never changed), queries push the two boundary
+        // paths and then run the usual bottom-up loop.
+        // Any value, lowest() and max() included, may be stored: whether a node has a second
+        // largest / smallest value is told by its counts (maxc < len), lowest / max() in
+        // max2 / min2 are only neutral fillers. Sums and differences of values must fit
+        // in value_type, and so must a value plus the adds that follow it until a chmin /
+        // chmax (pending above it) is pushed down to its node.
+        template<typename Container>
+            class SegTree {
+                typedef typename Container::size_type size_type;
+                typedef typename Container::size_type index_type;
+                typedef typename Container::value_type value_type;
+                static constexpr value_type lowest = std::numeric_limits<value_type>::lowest();
+                static constexpr value_type highest = std::numeric_limits<value_type>::max();
+                typedef std::uint32_t count_type; // counts and lengths, so n < 2^32
+                struct Node {
+                    value_type sum = 0, add = 0;
+                    value_type max1 = lowest, max2 = lowest, min1 = highest, min2 = highest;
+                    count_type maxc = 0, minc = 0, len = 0;
+                };
+                std::vector<Node> t;
+                index_type m_size, m_half, h;
+                static void set_leaf(Node &x, const value_type &v) {
+                    x = {v, 0, v, lowest, v, highest, 1, 1, 1};
+                }
+                void pull(index_type p) {
+                    auto &x = t[p];
+                    const auto &a = t[p<<1], &b = t[(p<<1)^1];
+                    x.sum = a.sum + b.sum;
+                    if (a.max1 == b.max1)
+                        x.max1 = a.max1, x.maxc = a.maxc + b.maxc, x.max2 = std::max(a.max2, b.max2);
+                    else if (a.max1 > b.max1)
+                        x.max1 = a.max1, x.maxc = a.maxc, x.max2 = std::max(a.max2, b.max1);
+                    else
+                        x.max1 = b.max1, x.maxc = b.maxc, x.max2 = std::max(a.max1, b.max2);
+                    if (a.min1 == b.min1)
+                        x.min1 = a.min1, x.minc = a.minc + b.minc, x.min2 = std::min(a.min2, b.min2);
+                    else if (a.min1 < b.min1)
+                        x.min1 = a.min1, x.minc = a.minc, x.min2 = std::min(a.min2, b.min1);
+                    else
+                        x.min1 = b.min1, x.minc = b.minc, x.min2 = std::min(a.min1, b.min2);
+                }
+                static void apply_add(Node &x, const value_type &v) {
+                    if (!x.len)
+                        return;
+                    x.sum += v*static_cast<value_type>(x.len);
+                    x.add += v;
+                    x.max1 += v;
+                    x.min1 += v;
+                    if (x.maxc < x.len)
+                        x.max2 += v;
+                    if (x.minc < x.len)
+                        x.min2 += v;
+                }
+                // requires max2 < v < max1 (or no max2)
+                static void apply_chmin(Node &x, const value_type &v) {
+                    x.sum -= (x.max1 - v)*static_cast<value_type>(x.maxc);
+                    if (x.min1 == x.max1)
+                        x.min1 = v;
+                    else if (x.min2 == x.max1)
+                        x.min2 = v;
+                    x.max1 = v;
+                }
+                // requires min1 < v < min2 (or no min2)
+                static void apply_chmax(Node &x, const value_type &v) {
+                    x.sum += (v - x.min1)*static_cast<value_type>(x.minc);
+                    if (x.max1 == x.min1)
+                        x.max1 = v;
+                    else if (x.max2 == x.min1)
+                        x.max2 = v;
+                    x.min1 = v;
+                }
+                void push(index_type p) {
+                    auto &x = t[p];
+                    for (auto c: {p<<1, (p<<1)^1}) {
+                        auto &y = t[c];
+                        if (!y.len)
+                            continue;
+                        if (x.add)
+                            apply_add(y, x.add);
+                        if (y.max1 > x.max1)
+                            apply_chmin(y, x.max1);
+                        if (y.min1 < x.min1)
+                            apply_chmax(y, x.min1);
+                    }
+                    x.add = 0;
+                }
+                void push_paths(index_type l, index_type r) {
+                    l += m_half, r += m_half - 1;
+                    for (auto s = h; s > 0; --s) {
+                        push(l >> s);
+                        if ((r >> s) != (l >> s))
+                            push(r >> s);
+                    }
+                }
+                // walk [l; r): skip nodes where stop(node), apply(node) to covered nodes where tag(node)
+                // and to covered leaves, go down otherwise
+                template <typename Stop, typename Tag, typename Apply>
+                    void update(index_type l, index_type r, Stop stop, Tag tag, Apply apply) {
+                        index_type stack[2*sizeof(index_type)*8 + 2]; // (p << 1) | pull
+                        index_type top = 0;
+                        stack[top++] = 1 << 1;
+                        while (top) {
+                            const auto e = stack[--top], p = e >> 1;
+                            if (e & 1) {
+                                pull(p);
+                                continue;
+                            }
+                            const index_type k = h + 1 - std::bit_width(p);
+                            const index_type lo = (p << k) - m_half, hi = lo + (index_type(1) << k);
+                            if (hi <= l || r <= lo || stop(t[p]))
+                                continue;
+                            if (l <= lo && hi <= r && (p >= m_half || tag(t[p]))) {
+                                apply(t[p]);
+                                continue;
+                            }
+                            push(p);
+                            stack[top++] = e | 1;
+                            stack[top++] = ((p<<1)^1) << 1;
+                            stack[top++] = (p<<1) << 1;
+                        }
+                    }
+                template <typename Source>
+                    void init(Source src) {
+                        for (index_type i = 0; i < m_size; ++i)
+                            set_leaf(t[m_half + i], src());
+                        for (index_type p = m_half; p-- > 1; ) {
+                            t[p].len = t[p<<1].len + t[(p<<1)^1].len;
+                            pull(p);
+                        }
+                    }
+                public:
+                SegTree(index_type size) : SegTree(size, value_type()) {
+                }
+                template <typename Source>
+                    SegTree(index_type size, Source src) : t(2*std::bit_ceil(std::max<index_type>(size, 1))), m_size(size), m_half(t.size() >> 1), h(std::bit_width(m_half) - 1) {
+                        init(src);
+                    }
+                SegTree(index_type size, const value_type &initv) : SegTree(size, [&initv]() { return initv; }) {
+                }
+                template <typename Iterator>
+                    SegTree(Iterator begin, Iterator end) : SegTree(std::distance(begin, end), [begin]() mutable { return *begin++; }) {
+                    }
+                SegTree(const Container &c) : SegTree(c.cbegin(), c.cend()) {
+                }
+                SegTree(const SegTree &) = default;
+                SegTree(SegTree &&) = default;
+                constexpr auto size () const noexcept { return m_size; }
+                // a[i] = min(a[i], v) for i in [l; r)
+                void range_chmin(index_type l, index_type r, const value_type &v) {
+                    update(l, r, [&v](const Node &x) { return x.max1 <= v; },
+                            [&v](const Node &x) { return x.maxc == x.len || x.max2 < v; },
+                            [&v](Node &x) { apply_chmin(x, v); });
+                }
+                // a[i] = max(a[i], v) for i in [l; r)
+                void range_chmax(index_type l, index_type r, const value_type &v) {
+                    update(l, r, [&v](const Node &x) { return x.min1 >= v; },
+                            [&v](const Node &x) { return x.minc == x.len || x.min2 > v; },
+                            [&v](Node &x) { apply_chmax(x, v); });
+                }
+                // a[i] += v for i in [l; r)
+                // add needs no beats descent: tag the O(log n) covering nodes bottom-up, then
+                // recompute the two boundary paths
+                void range_add(index_type l, index_type r, const value_type &v) {
+                    if (l >= r)
+                        return;
+                    push_paths(l, r);
+                    const index_type l0 = l + m_half, r0 = r + m_half - 1;
+                    for (l += m_half, r += m_half; l < r; l >>= 1, r >>= 1) {
+                        if (l & 1)
+                            apply_add(t[l++], v);
+                        if (r & 1)
+                            apply_add(t[--r], v);
+                    }
+                    // path nodes were pushed, so a pending add on one of them is from this update
+                    auto repull = [this](index_type p) {
+                        pull(p);
+                        if (auto a = t[p].add) {
+                            t[p].add = 0;
+                            apply_add(t[p], a);
+                        }
+                    };
+                    for (index_type s = 1; s <= h; ++s) {
+                        repull(l0 >> s);
+                        if ((r0 >> s) != (l0 >> s))
+                            repull(r0 >> s);
+                    }
+                }
+                value_type range_sum(index_type l, index_type r) { // [ l; r )
+                    value_type res = 0;
+                    if (l >= r)
+                        return res;
+                    push_paths(l, r);
+                    for (l += m_half, r += m_half; l < r; l >>= 1, r >>= 1) {
+                        if (l & 1)
+                            res += t[l++].sum;
+                        if (r & 1)
+                            res += t[--r].sum;
+                    }
+                    return res;
+                }
+                value_type range_min(index_type l, index_type r) { // [ l; r )
+                    value_type res = highest;
+                    if (l >= r)
+                        return res;
+                    push_paths(l, r);
+                    for (l += m_half, r += m_half; l < r; l >>= 1, r >>= 1) {
+                        if (l & 1)
+                            res = std::min(res, t[l++].min1);
+                        if (r & 1)
+                            res = std::min(res, t[--r].min1);
+                    }
+                    return res;
+                }
+                value_type range_max(index_type l, index_type r) { // [ l; r )
+                    value_type res = lowest;
+                    if (l >= r)
+                        return res;
+                    push_paths(l, r);
+                    for (l += m_half, r += m_half; l < r; l >>= 1, r >>= 1) {
+                        if (l & 1)
+                            res = std::max(res, t[l++].max1);
+                        if (r & 1)
+                            res = std::max(res, t[--r].max1);
+                    }
+                    return res;
+                }
+                value_type query(index_type index) {
+                    push_paths(index, index + 1);
+                    return t[m_half + index].sum;
+                }
+                auto operator [](size_type index) {
                     return query(index);
                 }
             };
-        //template<typename Container>
-        //using SegTreeMinInc = SegTree<Container, FunctionalMin<typename Container::value_type>, std::plus<typename Container::value_type>, 0>;
-        //template<typename Container>
-        //using SegTreeMaxInc = SegTree<Container, FunctionalMax<typename Container::value_type>, std::plus<typename Container::value_type>, 0>;
     }
 };
 #endif // SEGMENT_TREE_NREC_HPP
@@ -0,0 +1,131 @@
+#include <bits/stdc++.h>
+#include "bench.hpp"
+#include "tiered-vector.hpp"
+using namespace std;
+// see bench.hpp for build/run instructions
+
+// the operations ktiered_vector<T, K> shares with tiered_vector
+template <unsigned K>
+void bench_ktiered(size_t n, size_t m, size_t mi, const vector<size_t> &pos) {
+    const auto name = "ktiered_vector<" + to_string(K) + ">/";
+    auto bytes = Bench::live_bytes();
+    auto tv = Bench::build((name + "build").c_str(), n, [&]() {
+        ktiered_vector<int64_t, K> tv(n);
+        for (size_t i = 0; i < n; ++i)
+            tv[i] = i;
+        return tv;
+    });
+    bytes = Bench::live_bytes() - bytes;
+    Bench::run((name + "operator[]").c_str(), n, m, bytes, [&]() {
+        int64_t acc = 0;
+        for (auto i: pos)
+            acc += tv[i];
+        Bench::keep(acc);
+    });
+    Bench::run((name + "scan").c_str(), n, n, bytes, [&]() {
+        Bench::keep(accumulate(tv.cbegin(), tv.cend(), int64_t(0)));
+    });
+    Bench::run((name + "insert").c_str(), n, mi, bytes, [&]() {
+        for (size_t i = 0; i < mi; ++i)
+            tv.insert(tv.begin() + pos[i], i);
+    });
+    Bench::run((name + "erase").c_str(), n, mi, bytes, [&]() {
+        for (size_t i = 0; i < mi; ++i)
+            tv.erase(tv.begin() + pos[i]);
+    });
+    Bench::run((name + "push_back").c_str(), n, mi, bytes, [&]() {
+        for (size_t i = 0; i < mi; ++i)
+            tv.push_back(i);
+    });
+    Bench::run((name + "pop_back").c_str(), n, mi, bytes, [&]() {
+        for (size_t i = 0; i < mi; ++i)
+            tv.pop_back();
+    });
+}
+
+int main(int argc, char *argv[]) {
+    Bench::header();
+    for (auto n: Bench::sizes(argc, argv)) {
+        const auto m = Bench::ops(n);
+        const size_t mi = min<size_t>(m, 100'000); // insert/erase are O(sqrt n)
+        auto g = Bench::rng();
+        vector<size_t> pos(m);
+        for (auto &x: pos)
+            x = g() % n;
+        auto bytes = Bench::live_bytes();
+        auto tv = Bench::build("tiered_vector/build", n, [&]() {
+            tiered_vector<int64_t> tv(n);
+            for (size_t i = 0; i < n; ++i)
+                tv[i] = i;
+            return tv;
+        });
+        bytes = Bench::live_bytes() - bytes;
+        Bench::run("tiered_vector/operator[]", n, m, bytes, [&]() {
+            int64_t acc = 0;
+            for (auto i: pos)
+                acc += tv[i];
+            Bench::keep(acc);
+        });
+        Bench::run("tiered_vector/scan", n, n, bytes, [&]() {
+            Bench::keep(accumulate(tv.begin(), tv.end(), int64_t(0)));
+        });
+        Bench::run("tiered_vector/scan(for_each_segment)", n, n, bytes, [&]() {
+            int64_t acc = 0;
+            tv.for_each_segment([&](span<const int64_t> s) {
+                acc = accumulate(s.begin(), s.end(), acc);
+            });
+            Bench::keep(acc);
+        });
+        Bench::run("tiered_vector/insert", n, mi, bytes, [&]() {
+            for (size_t i = 0; i < mi; ++i)
+                tv.insert(tv.begin() + pos[i], i);
+        });
+        Bench::run("tiered_vector/erase", n, mi, bytes, [&]() {
+            for (size_t i = 0; i < mi; ++i)
+                tv.erase(tv.begin() + pos[i]);
+        });
+        // near the front: shifts the pieces before the position
+        Bench::run("tiered_vector/insert(front 1/16)", n, mi, bytes, [&]() {
+            for (size_t i = 0; i < mi; ++i)
+                tv.insert(tv.begin() + pos[i]/16, i);
+        });
+        Bench::run("tiered_vector/erase(front 1/16)", n, mi, bytes, [&]() {
+            for (size_t i = 0; i < mi; ++i)
+                tv.erase(tv.begin() + pos[i]/16);
+        });
+        // bulk splices of k elements; ns/op is per element, compare with insert/erase
+        for (size_t k: { 16, 1024 }) {
+            const auto ms = max<size_t>(1, mi/k);
+            vector<int64_t> src(k, 1);
+            const auto suffix = "(k=" + to_string(k) + ")";
+            Bench::run(("tiered_vector/insert_range" + suffix).c_str(), n, ms*k, bytes, [&]() {
+                for (size_t i = 0; i < ms; ++i)
+                    tv.insert(tv.begin() + pos[i], src.begin(), src.end());
+            });
+            Bench::run(("tiered_vector/erase_range" + suffix).c_str(), n, ms*k, bytes, [&]() {
+                for (size_t i = 0; i < ms; ++i)
+                    tv.erase(tv.begin() + pos[i], tv.begin() + pos[i] + k);
+            });
+        }
+        Bench::run("tiered_vector/push_back", n, mi, bytes, [&]() {
+            for (size_t i = 0; i < mi; ++i)
+                tv.push_back(i);
+        });
+        Bench::run("tiered_vector/pop_back", n, mi, bytes, [&]() {
+            for (size_t i = 0; i < mi; ++i)
+                tv.pop_back();
+        });
+        Bench::run("tiered_vector/push_front", n, mi, bytes, [&]() {
+            for (size_t i = 0; i < mi; ++i)
+                tv.push_front(i);
+        });
+        Bench::run("tiered_vector/pop_front", n, mi, bytes, [&]() {
+            for (size_t i = 0; i < mi; ++i)
+                tv.pop_front();
+        });
+        bench_ktiered<3>(n, m, mi, pos);
+        bench_ktiered<4>(n, m, mi, pos);
+    }
+    return 0;
+}
+// vim: sw=4 et
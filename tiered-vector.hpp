@@ -2,12 +2,18 @@
 #define TIERED_VECTOR_HPP
 #include <vector>
 #include <array>
+#include <bit>
 #include <iterator>
 #include <type_traits>
 #include <algorithm>
+#include <limits>
+#include <span>
+#include <utility>
 // vector with sqrt-decomposition
 // supports O(1) access
-// O(piece_size + n/piece_size) insert and erase in the middle, ammortized O(1) push_back and pop_back
+// O(piece_size + n/piece_size) insert and erase in the middle, shifting whichever side of
+// the position is shorter; ammortized O(1) push_back and pop_back, O(n/piece_size) push_front
+// and pop_front (a gap of up to 2*piece_size free slots is kept before the first element)
 // (assuming $piece_size \approx \sqrt n$, it's O(\sqrt n))
 template <typename T>
 class tiered_vector {
@@ -21,6 +27,7 @@ class tiered_vector {
     public:
     size_type m_shift;
     size_type m_size = 0;
+    size_type m_begin = 0; // free slots before the first element, < 2*piece_size()
     std::vector<value_type> m_rep;
     std::vector<size_type> m_pos;
     constexpr size_type piece_size() const noexcept { return (static_cast<size_type>(1)<<m_shift); }
@@ -43,11 +50,42 @@ class tiered_vector {
     tiered_vector & operator = (const tiered_vector &other) = default;
     tiered_vector & operator = (tiered_vector &&other) = default;
     void swap(tiered_vector &other) {
-        swap(m_rep, other.m_rep);
-        swap(m_pos, other.m_pos);
-        swap(m_size, other.m_size);
+        std::swap(m_shift, other.m_shift);
+        std::swap(m_size, other.m_size);
+        std::swap(m_begin, other.m_begin);
+        m_rep.swap(other.m_rep);
+        m_pos.swap(other.m_pos);
     }
     private:
+    // element at virtual position v = pos + m_begin
+    reference slot(size_type v) noexcept {
+        return m_rep[(v & ~mask()) + ((m_pos[v >> m_shift] + v) & mask())];
+    }
+    const_reference slot(size_type v) const noexcept {
+        return m_rep[(v & ~mask()) + ((m_pos[v >> m_shift] + v) & mask())];
+    }
+    // rotate the ring of piece idx: element at logical slot s moves to s - d
+    void rotate(size_type idx, size_type d) noexcept {
+        m_pos[idx] = (m_pos[idx] + d) & mask();
+    }
+    // number of pieces covering virtual positions [0; vend)
+    size_type pieces(size_type vend) const noexcept {
+        return (vend + mask()) >> m_shift;
+    }
+    // make room for virtual positions [0; vend); new pieces start at ring offset 0
+    void fit(size_type vend) {
+        m_pos.resize(pieces(vend));
+        if (auto new_size = (m_pos.size() << m_shift); new_size > m_rep.size())
+            m_rep.resize(new_size);
+    }
+    // flatten and switch to new_shift
+    void reshape(size_type new_shift) {
+        flatten();
+        m_shift = new_shift;
+        m_pos.clear();
+        fit(m_size);
+    }
+    public:
     template <typename IV, typename IT>
     class Iterator {
         IV *base;
@@ -95,14 +133,10 @@ class tiered_vector {
     typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
     // time O(1)
     reference operator[](size_type pos) noexcept {
-        auto idx = pos >> m_shift;
-        auto sub = pos & mask();
-        return m_rep[(pos & ~mask()) + ((m_pos[idx] + sub) & mask())];
+        return slot(pos + m_begin);
     }
     const_reference operator[](size_type pos) const noexcept {
-        auto idx = pos >> m_shift;
-        auto sub = pos & mask();
-        return m_rep[(pos & ~mask()) + ((m_pos[idx] + sub) & mask())];
+        return slot(pos + m_begin);
     }
     reference at(size_type pos) {
         if (pos >= size())
@@ -134,136 +168,251 @@ class tiered_vector {
         return m_size;
     }
     bool empty() const {
-        return m_pos.empty();
+        return m_size == 0;
     }
     size_t capacity() const {
         return m_rep.capacity();
     }
     void resize(size_t new_size) {
         reserve(new_size);
+        const auto old_size = m_size;
         m_size = new_size;
-        m_pos.resize((m_size + mask()) >> m_shift);
-        auto new_rep_size = m_pos.size() << m_shift;
-        if (new_rep_size > m_rep.size())
-            m_rep.resize(new_rep_size);
+        if (!m_size)
+            m_begin = 0;
+        fit(m_begin + m_size);
+        // freed slots keep stale values
+        for (auto i = old_size; i < m_size; ++i)
+            (*this)[i] = value_type();
     }
     void reserve(size_t new_size) {
         if (new_size <= m_size)
             return;
-        if (auto new_shift = size2shift(new_size); new_shift > m_shift) {
-            flatten();
-            m_shift = new_shift;
-            m_pos.clear();
-            m_pos.resize((m_size + mask()) >> m_shift);
-            if (auto new_size = (m_pos.size() << m_shift); new_size > m_rep.size())
-                m_rep.resize(new_size);
-        }
-        auto new_rep_size = (new_size + mask()) >> m_shift;
+        if (auto new_shift = size2shift(new_size); new_shift > m_shift)
+            reshape(new_shift);
+        auto new_rep_size = pieces(m_begin + new_size);
         m_pos.reserve(new_rep_size);
         m_rep.reserve(new_rep_size << m_shift);
     }
     void shrink_to_fit() {
-        if (auto new_shift = size2shift(m_size); new_shift < m_shift) {
-            flatten();
-            m_shift = new_shift;
-            m_pos.clear();
-            m_pos.resize((m_size + mask()) >> m_shift);
-        }
+        if (auto new_shift = size2shift(m_size); new_shift < m_shift)
+            reshape(new_shift);
         m_rep.resize(m_pos.size() << m_shift);
         m_rep.shrink_to_fit();
         m_pos.shrink_to_fit();
     }
+    // time = O(piece_size + n/piece_size); shifts the shorter side of pos, cascading
+    // through the pieces before it (move-to-front) or after it (move-to-back)
     iterator erase(iterator cpos) {
-        auto idx = cpos.pos >> m_shift;
-        auto sub = cpos.pos & mask();
-        auto spos = cpos.pos - sub;
-        auto &pos = m_pos[idx];
-        // TODO choose either move-to-front or move-to-back, depending on which is smaller
-        if (sub == 0) {
-            pos = (pos + 1) & mask();
+        const auto v = m_begin + cpos.pos, vend = m_begin + m_size;
+        const auto q = v >> m_shift;
+        if (2*cpos.pos + 1 < m_size) {
+            // elements [m_begin; v) move right by one
+            const auto first = m_begin >> m_shift;
+            if (q == first) {
+                for (auto u = v; u > m_begin; --u)
+                    slot(u) = std::move(slot(u - 1));
+            } else {
+                const auto spos = q << m_shift, next = spos + piece_size();
+                if (next <= vend && next - 1 - v < v - spos) {
+                    for (auto u = v; u + 1 < next; ++u)
+                        slot(u) = std::move(slot(u + 1));
+                    rotate(q, -1);
+                } else {
+                    for (auto u = v; u > spos; --u)
+                        slot(u) = std::move(slot(u - 1));
+                }
+                for (auto p = q; p-- > first; ) {
+                    slot((p + 1) << m_shift) = std::move(slot(((p + 1) << m_shift) - 1));
+                    rotate(p, -1);
+                }
+            }
+            if (++m_begin >= 2*piece_size()) {
+                m_rep.erase(m_rep.begin(), m_rep.begin() + piece_size());
+                m_pos.erase(m_pos.begin());
+                m_begin -= piece_size();
+            }
         } else {
-            auto eop = idx + 1 == m_pos.size() ? (pos + m_size) & mask() : pos;
-            sub = (sub + pos) & mask();
-            for (;;) {
-                auto next = (sub + 1) & mask();
-                if (next == eop)
-                    break;
-                m_rep[spos + sub] = std::move(m_rep[spos + next]);
-                sub = next;
+            // elements (v; vend) move left by one
+            const auto last = (vend - 1) >> m_shift;
+            if (q == last) {
+                for (auto u = v; u + 1 < vend; ++u)
+                    slot(u) = std::move(slot(u + 1));
+            } else {
+                const auto spos = q << m_shift, next = spos + piece_size();
+                if (m_begin <= spos && v - spos < next - 1 - v) {
+                    for (auto u = v; u > spos; --u)
+                        slot(u) = std::move(slot(u - 1));
+                    rotate(q, 1);
+                } else {
+                    for (auto u = v; u + 1 < next; ++u)
+                        slot(u) = std::move(slot(u + 1));
+                }
+                for (auto p = q + 1; p <= last; ++p) {
+                    slot((p << m_shift) - 1) = std::move(slot(p << m_shift));
+                    rotate(p, 1);
+                }
             }
+            if (((vend - 1) & mask()) == 0)
+                m_pos.pop_back();
         }
-        auto last = (m_pos[idx] - 1) & mask();
-        while(++idx != m_pos.size()) {
-            auto &npos = m_pos[idx];
-            m_rep[spos + last] = std::move(m_rep[spos + piece_size() + npos]);
-            last = npos;
-            npos = (npos + 1) & mask();
-            spos += piece_size();
+        if (--m_size == 0) {
+            m_begin = 0;
+            m_pos.clear();
         }
-        if ((--m_size & mask()) == 0)
-            m_pos.pop_back();
         return cpos;
     }
     void pop_back() {
         auto last = end();
         erase(--last);
     }
-    // time = O(piece_size)
-    iterator insert(iterator cpos, const value_type &v) {
+    // time = O(n/piece_size) amortized
+    void pop_front() {
+        erase(begin());
+    }
+    // time = O(piece_size + n/piece_size); shifts the shorter side of pos like erase()
+    iterator insert(iterator cpos, const value_type &x) {
         if ((size() & (size() - 1)) == 0)
             reserve(size()*2);
-        auto idx = cpos.pos >> m_shift;
-        auto sub = cpos.pos & mask();
-        auto spos = cpos.pos - sub;
-        if ((m_size & mask()) == 0) {
-            m_pos.emplace_back(0);
-            if (auto new_size = (m_pos.size() << m_shift); new_size > m_rep.size())
-                m_rep.resize(new_size);
+        if (2*cpos.pos < m_size) {
+            // elements [m_begin; v) move left by one, x goes to v - 1
+            if (m_begin == 0) {
+                m_rep.insert(m_rep.begin(), piece_size(), value_type());
+                m_pos.insert(m_pos.begin(), 0);
+                m_begin = piece_size();
+            }
+            const auto v = m_begin + cpos.pos, vend = m_begin + m_size;
+            const auto first = (m_begin - 1) >> m_shift, q = (v - 1) >> m_shift;
+            if (q == first) {
+                for (auto u = m_begin; u < v; ++u)
+                    slot(u - 1) = std::move(slot(u));
+            } else {
+                for (auto p = first; p < q; ++p) {
+                    rotate(p, 1);
+                    slot(((p + 1) << m_shift) - 1) = std::move(slot((p + 1) << m_shift));
+                }
+                const auto spos = q << m_shift, next = spos + piece_size();
+                if (next <= vend && next - v < v - 1 - spos) {
+                    rotate(q, 1);
+                    for (auto u = next - 1; u > v - 1; --u)
+                        slot(u) = std::move(slot(u - 1));
+                } else {
+                    for (auto u = spos + 1; u < v; ++u)
+                        slot(u - 1) = std::move(slot(u));
+                }
+            }
+            slot(v - 1) = x;
+            --m_begin;
+        } else {
+            // elements [v; vend) move right by one
+            const auto v = m_begin + cpos.pos, vend = m_begin + m_size;
+            if ((vend & mask()) == 0)
+                fit(vend + 1);
+            const auto q = v >> m_shift, last = vend >> m_shift;
+            if (q == last) {
+                for (auto u = vend; u > v; --u)
+                    slot(u) = std::move(slot(u - 1));
+            } else {
+                for (auto p = last; p > q; --p) {
+                    rotate(p, -1);
+                    slot(p << m_shift) = std::move(slot((p << m_shift) - 1));
+                }
+                const auto spos = q << m_shift, next = spos + piece_size();
+                if (m_begin <= spos && v - spos < next - 1 - v) {
+                    rotate(q, -1);
+                    for (auto u = spos; u < v; ++u)
+                        slot(u) = std::move(slot(u + 1));
+                } else {
+                    for (auto u = next - 1; u > v; --u)
+                        slot(u) = std::move(slot(u - 1));
+                }
+            }
+            slot(v) = x;
         }
-        if (spos + sub == m_size++) { // special case: push_back
-            m_rep[spos + ((sub + m_pos[idx]) & mask())] = v;
+        ++m_size;
+        return cpos;
+    }
+    // time = O(piece_size + k*n/piece_size) for k < piece_size, O(n - pos + k) otherwise
+    template <typename InputIt>
+    iterator insert(iterator cpos, InputIt first, InputIt last) {
+        if constexpr (!std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>) {
+            std::vector<value_type> tmp(first, last);
+            return insert(cpos, std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
+        } else {
+            const size_type k = std::distance(first, last);
+            if (k == 0)
+                return cpos;
+            const auto n = m_size, pos = cpos.pos;
+            reserve(std::bit_ceil(n + k));
+            const auto vp = m_begin + pos, vend = m_begin + n;
+            fit(vend + k);
+            const auto idx = vp >> m_shift;
+            if (k >= piece_size()) {
+                flatten(idx);
+                auto rep = m_rep.begin();
+                std::move_backward(rep + vp, rep + vend, rep + vend + k);
+            } else {
+                // the partial last piece moves element by element; every full piece after
+                // the one holding pos hands its last k elements to the head of the next
+                // piece and rotates its ring back by k; then the piece holding pos
+                const auto full = vend >> m_shift;
+                for (auto i = vend; i > std::max(vp, full << m_shift); --i)
+                    slot(i - 1 + k) = std::move(slot(i - 1));
+                for (auto j = full; j-- > idx + 1; ) {
+                    const auto spos = j << m_shift, next = spos + piece_size();
+                    const auto from = (m_pos[j] - k) & mask(), to = m_pos[j + 1];
+                    for (size_type t = 0; t < k; ++t)
+                        m_rep[next + ((to + t) & mask())] = std::move(m_rep[spos + ((from + t) & mask())]);
+                    m_pos[j] = from;
+                }
+                if (idx < full)
+                    for (auto i = (idx + 1) << m_shift; i-- > vp; )
+                        slot(i + k) = std::move(slot(i));
+            }
+            m_size = n + k;
+            std::copy(first, last, iterator(this, pos));
             return cpos;
         }
-        auto endidx = m_pos.size();
-        auto endpos = (m_pos.size() - 1) << m_shift;
-        while(--endidx > idx) {
-            auto &pos = m_pos[endidx];
-            pos = (pos - 1) & mask();
-            auto prevpos = endpos - piece_size();
-            auto prevlast = (m_pos[endidx - 1] - 1) & mask();
-            m_rep[endpos + pos] = std::move(m_rep[prevpos + prevlast]);
-            endpos = prevpos;
-        }
-#if 0
-        auto eop = pos - sub;
-        for (auto t = eop + piece_size; --t > pos; )
-            (*this)[t] = std::move((*this)[t - 1]);
-        (*this)[pos] = v;
-#else
-        auto &pos = m_pos[idx];
-        // TODO choose either move-to-front or move-to-back, depending on which is smaller
-        if (sub == 0) {
-            pos = (pos - 1) & mask();
-            m_rep[spos + pos] = v;
+    }
+    // time = O(piece_size + k*n/piece_size) for k < piece_size, O(n - pos) otherwise
+    iterator erase(iterator cfirst, iterator clast) {
+        const auto k = clast.pos - cfirst.pos;
+        if (k == 0)
+            return cfirst;
+        const auto vp = m_begin + cfirst.pos, vend = m_begin + m_size;
+        const auto idx = vp >> m_shift;
+        if (k >= piece_size()) {
+            flatten(idx);
+            auto rep = m_rep.begin();
+            std::move(rep + vp + k, rep + vend, rep + vp);
         } else {
-            auto eop = idx + 1 == m_pos.size() ? pos + m_size : pos;
-            eop = (eop - 1) & mask();
-            auto cv = (pos + sub) & mask();
-            while(eop != cv) {
-                auto next = (eop - 1) & mask();
-                m_rep[spos + eop] = std::move(m_rep[spos + next]);
-                eop = next;
+            // the piece holding pos moves element by element; every later piece rotates
+            // its ring forward by k and takes the first k elements of the next one as tail
+            for (auto i = vp; i < std::min(vend - k, (idx + 1) << m_shift); ++i)
+                slot(i) = std::move(slot(i + k));
+            for (auto j = idx + 1; j < m_pos.size(); ++j) {
+                const auto spos = j << m_shift, next = spos + piece_size();
+                const auto to = m_pos[j];
+                m_pos[j] = (to + k) & mask();
+                if (next < vend) {
+                    const auto from = m_pos[j + 1];
+                    for (size_type t = 0; t < std::min(k, vend - next); ++t)
+                        m_rep[spos + ((to + t) & mask())] = std::move(m_rep[next + ((from + t) & mask())]);
+                }
             }
-            m_rep[spos + cv] = v;
         }
-        #endif
-        return cpos;
+        if ((m_size -= k) == 0) {
+            m_begin = 0;
+            m_pos.clear();
+        } else {
+            m_pos.resize(pieces(m_begin + m_size));
+        }
+        return cfirst;
     }
-    void flatten() {
-        if (empty()) return;
-        size_t idx = 0;
-        auto spos = m_rep.begin();
-        for(; idx != m_pos.size(); ++idx) {
+    private:
+    // rotate pieces from idx on back to ring offset 0
+    void flatten(size_type idx) {
+        auto spos = m_rep.begin() + (idx << m_shift);
+        for(; idx < m_pos.size(); ++idx) {
             auto next = spos + piece_size();
             if (m_pos[idx]) {
                 std::rotate(spos, spos + m_pos[idx], next);
@@ -272,9 +421,307 @@ class tiered_vector {
             spos = next;
         }
     }
+    // the elements [first; last) as contiguous runs of the pieces' rings
+    template <typename Self, typename F>
+    static void segments(Self &self, size_type first, size_type last, F &f) {
+        const auto rep = self.m_rep.data();
+        for (auto v = self.m_begin + first, vend = self.m_begin + last; v < vend; ) {
+            const auto spos = v & ~self.mask(), next = std::min(spos + self.piece_size(), vend);
+            const auto p = (self.m_pos[v >> self.m_shift] + v) & self.mask();
+            const auto len = std::min(next - v, self.piece_size() - p);
+            f(std::span(rep + spos + p, len));
+            v += len;
+        }
+    }
+    public:
+    // calls f(std::span<T>) on consecutive runs of [first; last) in order, at most two
+    // per piece (where its ring wraps); unlike iterators, loops over the spans vectorize
+    template <typename F>
+    void for_each_segment(iterator first, iterator last, F f) {
+        segments(*this, first.pos, last.pos, f);
+    }
+    template <typename F>
+    void for_each_segment(const_iterator first, const_iterator last, F f) const {
+        segments(*this, first.pos, last.pos, f);
+    }
+    template <typename F>
+    void for_each_segment(F f) {
+        segments(*this, 0, m_size, f);
+    }
+    template <typename F>
+    void for_each_segment(F f) const {
+        segments(*this, 0, m_size, f);
+    }
+    // rotate every piece back and move the elements to the start of m_rep,
+    // so that m_rep[i] is element i
+    void flatten() {
+        flatten(0);
+        if (m_begin) {
+            std::move(m_rep.begin() + m_begin, m_rep.begin() + m_begin + m_size, m_rep.begin());
+            m_begin = 0;
+            m_pos.resize(pieces(m_size));
+        }
+    }
+    auto &push_back(const value_type &v) {
+        return *insert(end(), v);
+    }
+    // time = O(n/piece_size) amortized
+    auto &push_front(const value_type &v) {
+        return *insert(begin(), v);
+    }
+    auto &back() { return (*this)[size() - 1]; }
+    const auto &back() const { return (*this)[size() - 1]; }
+    auto &front() { return (*this)[0]; }
+    const auto &front() const { return (*this)[0]; }
+};
+// k-level tiered vector (Goodrich, Kloss: Tiered Vectors, 1999), tiered_vector generalized:
+// a level-j node holds piece_size^j elements as a ring of piece_size level-(j-1) nodes,
+// rotated by an offset counted in elements (so pushing an element into one end of a full
+// node and popping the other end is O(1)); the top level is a vector of level-(K-1) nodes.
+// supports O(K) access
+// O(K piece_size) insert and erase anywhere, piece_size \approx n^(1/K)
+template <typename T, unsigned K = 3>
+class ktiered_vector {
+    static_assert(K >= 2, "use std::vector");
+    public:
+    typedef std::size_t size_type;
+    typedef T value_type;
+    typedef T &reference;
+    typedef const T &const_reference;
+    private:
+    size_type m_shift;
+    size_type m_size = 0;
+    std::vector<value_type> m_rep;
+    std::array<std::vector<size_type>, K - 1> m_rot; // m_rot[j - 1][i]: offset of the i-th level-j node
+    constexpr size_type piece_size() const noexcept { return (static_cast<size_type>(1)<<m_shift); }
+    constexpr size_type top_shift() const noexcept { return m_shift*(K - 1); }
+    constexpr size_type top_mask() const noexcept { return (static_cast<size_type>(1)<<top_shift()) - 1; }
+    // smallest shift with piece_size^K >= s
+    static size_type size2shift(size_type s) noexcept {
+        size_type shift = 1;
+        while (shift*K < std::numeric_limits<size_type>::digits && (static_cast<size_type>(1)<<(shift*K)) < s)
+            ++shift;
+        return shift;
+    }
+    // index in m_rep of element x of the level-j node starting at m_rep[base]
+    size_type index(unsigned j, size_type base, size_type x) const noexcept {
+        for (; j; --j) {
+            const auto s = m_shift*j;
+            const auto p = (x + m_rot[j - 1][base >> s]) & ((static_cast<size_type>(1)<<s) - 1);
+            const auto cm = (static_cast<size_type>(1)<<(s - m_shift)) - 1;
+            base += p & ~cm;
+            x = p & cm;
+        }
+        return base;
+    }
+    // in the level-j node at base: removes element b, inserts val so that it ends up at a
+    // (the elements in between move by one towards b), returns the removed element
+    value_type shift(unsigned j, size_type base, size_type a, size_type b, value_type val) {
+        const auto s = m_shift*j, m = (static_cast<size_type>(1)<<s) - 1;
+        const auto cm = (static_cast<size_type>(1)<<(s - m_shift)) - 1;
+        auto &off = m_rot[j - 1][base >> s];
+        if ((a == 0 && b == m) || (a == m && b == 0)) {
+            // the whole node: rotate, the freed slot takes val
+            if (a == 0)
+                off = (off - 1) & m;
+            auto &e = m_rep[index(j - 1, base + (off & ~cm), off & cm)];
+            if (a != 0)
+                off = (off + 1) & m;
+            return std::exchange(e, std::move(val));
+        }
+        const auto pa = (a + off) & m, pb = (b + off) & m;
+        if ((a <= b) == (pa <= pb))
+            return shift_children(j, base, pa, pb, std::move(val));
+        // the range wraps around the end of the ring
+        if (a <= b)
+            return shift_children(j, base, 0, pb, shift_children(j, base, pa, m, std::move(val)));
+        return shift_children(j, base, m, pb, shift_children(j, base, pa, 0, std::move(val)));
+    }
+    // shift() on the children of the node, with positions pa, pb in the order of the children
+    value_type shift_children(unsigned j, size_type base, size_type pa, size_type pb, value_type val) {
+        if (j == 1) {
+            auto first = m_rep.begin() + base;
+            auto res = std::move(first[pb]);
+            if (pa <= pb)
+                std::move_backward(first + pa, first + pb, first + pb + 1);
+            else
+                std::move(first + pb + 1, first + pa + 1, first + pb);
+            first[pa] = std::move(val);
+            return res;
+        }
+        const auto cs = m_shift*(j - 1), cm = (static_cast<size_type>(1)<<cs) - 1;
+        const auto ca = pa >> cs, cb = pb >> cs;
+        if (ca == cb)
+            return shift(j - 1, base + (ca << cs), pa & cm, pb & cm, std::move(val));
+        // the children strictly between ca and cb only rotate by one
+        if (ca < cb) {
+            val = shift(j - 1, base + (ca << cs), pa & cm, cm, std::move(val));
+            for (auto c = ca + 1; c < cb; ++c)
+                val = shift(j - 1, base + (c << cs), 0, cm, std::move(val));
+            return shift(j - 1, base + (cb << cs), 0, pb & cm, std::move(val));
+        }
+        val = shift(j - 1, base + (ca << cs), pa & cm, 0, std::move(val));
+        for (auto c = ca - 1; c > cb; --c)
+            val = shift(j - 1, base + (c << cs), cm, 0, std::move(val));
+        return shift(j - 1, base + (cb << cs), cm, pb & cm, std::move(val));
+    }
+    // rotate the level-j node at base (and its children) back to offset 0
+    void flatten(unsigned j, size_type base) {
+        const auto s = m_shift*j;
+        if (j > 1)
+            for (size_type c = 0; c < piece_size(); ++c)
+                flatten(j - 1, base + (c << (s - m_shift)));
+        if (auto &off = m_rot[j - 1][base >> s]; off) {
+            std::rotate(m_rep.begin() + base, m_rep.begin() + base + off, m_rep.begin() + base + (static_cast<size_type>(1)<<s));
+            off = 0;
+        }
+    }
+    // make room for s elements; new nodes start at offset 0
+    void fit(size_type s) {
+        if (auto new_size = ((s + top_mask()) >> top_shift()) << top_shift(); new_size > m_rep.size()) {
+            m_rep.resize(new_size);
+            for (unsigned j = 1; j < K; ++j)
+                m_rot[j - 1].resize(new_size >> (m_shift*j));
+        }
+    }
+    // flatten and switch to new_shift
+    void reshape(size_type new_shift) {
+        flatten();
+        m_shift = new_shift;
+        m_rep.resize(((m_size + top_mask()) >> top_shift()) << top_shift());
+        for (unsigned j = 1; j < K; ++j)
+            m_rot[j - 1].assign(m_rep.size() >> (m_shift*j), 0);
+    }
+    public:
+    ktiered_vector(size_type s = 0, const value_type &v = {}) : m_shift(size2shift(s)) {
+        fit(s);
+        std::fill_n(m_rep.begin(), s, v);
+        m_size = s;
+    }
+    ktiered_vector(const ktiered_vector &other) = default;
+    ktiered_vector(ktiered_vector &&other) = default;
+    ktiered_vector & operator = (const ktiered_vector &other) = default;
+    ktiered_vector & operator = (ktiered_vector &&other) = default;
+    void swap(ktiered_vector &other) {
+        std::swap(m_shift, other.m_shift);
+        std::swap(m_size, other.m_size);
+        m_rep.swap(other.m_rep);
+        m_rot.swap(other.m_rot);
+    }
+    typedef typename tiered_vector<T>::template Iterator<ktiered_vector, value_type> iterator;
+    typedef typename tiered_vector<T>::template Iterator<const ktiered_vector, const value_type> const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+    // time O(K)
+    reference operator[](size_type pos) noexcept {
+        return m_rep[index(K - 1, pos & ~top_mask(), pos & top_mask())];
+    }
+    const_reference operator[](size_type pos) const noexcept {
+        return m_rep[index(K - 1, pos & ~top_mask(), pos & top_mask())];
+    }
+    reference at(size_type pos) {
+        if (pos >= size())
+            throw std::out_of_range("index is out of range");
+        return (*this)[pos];
+    }
+    const_reference at(size_type pos) const {
+        if (pos >= size())
+            throw std::out_of_range("index is out of range");
+        return (*this)[pos];
+    }
+    auto begin() noexcept { return iterator(this, 0); }
+    auto end() noexcept { return iterator(this, m_size); }
+    auto cbegin() const noexcept { return const_iterator(this, 0); }
+    auto cend() const noexcept { return const_iterator(this, m_size); }
+    auto rbegin() noexcept { return reverse_iterator(end()); }
+    auto rend() noexcept { return reverse_iterator(begin()); }
+    auto crbegin() const noexcept { return const_reverse_iterator(cend()); }
+    auto crend() const noexcept { return const_reverse_iterator(cbegin()); }
+    size_type size() const {
+        return m_size;
+    }
+    bool empty() const {
+        return m_size == 0;
+    }
+    size_t capacity() const {
+        return m_rep.capacity();
+    }
+    void resize(size_t new_size) {
+        reserve(new_size);
+        fit(new_size);
+        // freed slots keep stale values
+        for (auto i = m_size; i < new_size; ++i)
+            (*this)[i] = value_type();
+        m_size = new_size;
+    }
+    void reserve(size_t new_size) {
+        if (new_size <= m_size)
+            return;
+        if (auto new_shift = size2shift(new_size); new_shift > m_shift)
+            reshape(new_shift);
+        auto new_rep_size = ((new_size + top_mask()) >> top_shift()) << top_shift();
+        m_rep.reserve(new_rep_size);
+        for (unsigned j = 1; j < K; ++j)
+            m_rot[j - 1].reserve(new_rep_size >> (m_shift*j));
+    }
+    void shrink_to_fit() {
+        if (auto new_shift = size2shift(m_size); new_shift < m_shift)
+            reshape(new_shift);
+        const auto nodes = (m_size + top_mask()) >> top_shift();
+        m_rep.resize(nodes << top_shift());
+        m_rep.shrink_to_fit();
+        for (unsigned j = 1; j < K; ++j) {
+            m_rot[j - 1].resize(m_rep.size() >> (m_shift*j));
+            m_rot[j - 1].shrink_to_fit();
+        }
+    }
+    // rotate every node back, so that m_rep[i] is element i
+    void flatten() {
+        for (size_type base = 0; base < m_rep.size(); base += top_mask() + 1)
+            flatten(K - 1, base);
+    }
+    // time = O(K piece_size + n/piece_size^(K-1)), every top-level node after pos
+    // passes one element on in O(K)
+    iterator erase(iterator cpos) {
+        const auto v = cpos.pos, n = --m_size;
+        const auto t = v >> top_shift();
+        value_type e{};
+        auto b = n & top_mask();
+        for (auto i = n >> top_shift(); i > t; --i) {
+            e = shift(K - 1, i << top_shift(), b, 0, std::move(e));
+            b = top_mask();
+        }
+        shift(K - 1, t << top_shift(), b, v & top_mask(), std::move(e));
+        return cpos;
+    }
+    void pop_back() {
+        auto last = end();
+        erase(--last);
+    }
+    void pop_front() {
+        erase(begin());
+    }
+    iterator insert(iterator cpos, const value_type &x) {
+        if ((size() & (size() - 1)) == 0)
+            reserve(size()*2);
+        const auto v = cpos.pos, n = m_size;
+        fit(n + 1);
+        value_type e = x;
+        auto a = v & top_mask();
+        for (auto i = v >> top_shift(); i < (n >> top_shift()); ++i) {
+            e = shift(K - 1, i << top_shift(), a, top_mask(), std::move(e));
+            a = 0;
+        }
+        shift(K - 1, n & ~top_mask(), a, n & top_mask(), std::move(e));
+        ++m_size;
+        return cpos;
+    }
     auto &push_back(const value_type &v) {
         return *insert(end(), v);
     }
+    auto &push_front(const value_type &v) {
+        return *insert(begin(), v);
+    }
     auto &back() { return (*this)[size() - 1]; }
     const auto &back() const { return (*this)[size() - 1]; }
     auto &front() { return (*this)[0]; }